@@ -6,30 +6,53 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
+#include <future>
 #include <string>
 #include <vector>
+#include "camera-client.hpp"
+#include "client-options.hpp"
+#include "jitter-buffer.hpp"
+#include "mjpeg-server.hpp"
+#include "mosaic.hpp"
+#include "tiles.hpp"
 
 namespace po = boost::program_options;
+using namespace std::chrono;
 using namespace is::msg::camera;
 using namespace is::msg::common;
 
 int main(int argc, char* argv[]) {
-  std::string uri;
-  std::vector<std::string> cameras;
+  is::camera::ClientOptions common;
   Resolution resolution;
   SamplingRate sample_rate;
   double fps;
   std::string image_type;
+  unsigned short port;
+  int quality;
+  double max_wait;
+  double tolerance;
+  is::camera::DecodePolicy policy;
 
   po::options_description description("Allowed options");
   auto&& options = description.add_options();
   options("help,", "show available options");
-  options("uri,u", po::value<std::string>(&uri)->default_value("amqp://localhost"), "broker uri");
-  options("cameras,c", po::value<std::vector<std::string>>(&cameras)->multitoken(), "cameras");
+  common.add_uri(description);
+  common.add_cameras(description);
   options("height,h", po::value<unsigned int>(&resolution.height)->default_value(728), "image height");
   options("width,w", po::value<unsigned int>(&resolution.width)->default_value(1288), "image width");
   options("fps,f", po::value<double>(&fps)->default_value(5.0), "frames per second");
   options("type,t", po::value<std::string>(&image_type)->default_value("rgb"), "image type");
+  options("max-wait,m", po::value<double>(&max_wait), "max wait for late cameras [ms] (default: 1000/fps)");
+  options("tolerance", po::value<double>(&tolerance), "max timestamp distance within a set [ms] (default: 500/fps)");
+  options("background-every", po::value<unsigned int>(&policy.background_every)->default_value(5),
+          "decodes tiles out of focus on every n-th set");
+  options("focused-reduction", po::value<int>(&policy.focused_reduction)->default_value(2),
+          "decoding scale reduction of the focused tile [1|2|4|8]");
+  options("background-reduction", po::value<int>(&policy.background_reduction)->default_value(4),
+          "decoding scale reduction of the tiles out of focus [1|2|4|8]");
+  options("serve,p", po::value<unsigned short>(&port), "serves the mosaic as a mjpeg stream on this port");
+  options("quality,q", po::value<int>(&quality)->default_value(75), "jpeg quality of the mjpeg stream [0~100]");
+  options("headless", "does not open a window, only serves the stream");
 
   po::variables_map vm;
   po::store(po::parse_command_line(argc, argv, description), vm);
@@ -40,16 +63,28 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
-  auto is = is::connect(uri);
-  auto client = is::make_client(is);
+  if (policy.background_every < 1) {
+    is::logger()->error("--background-every must be at least 1");
+    return 1;
+  }
+
+  auto& cameras = common.cameras;
+  auto is = is::connect(common.uri);
+  is::camera::CameraClient client(common.uri);
 
   sample_rate.rate = fps;
+  std::vector<std::future<is::camera::Result>> setup;
   for (auto& camera : cameras) {
-    client.request(camera + ".set_sample_rate", is::msgpack(sample_rate));
-    client.request(camera + ".set_resolution", is::msgpack(resolution));
-    client.request(camera + ".set_image_type", is::msgpack(ImageType{image_type}));
+    setup.push_back(client.request(camera, "set_sample_rate", is::msgpack(sample_rate)));
+    setup.push_back(client.request(camera, "set_resolution", is::msgpack(resolution)));
+    setup.push_back(client.request(camera, "set_image_type", is::msgpack(ImageType{image_type})));
+  }
+  for (auto& future : setup) {
+    auto result = future.get();
+    auto error = is::camera::error_of(result);
+    if (!error.empty())
+      is::logger()->warn("[{}|{}] failed: {}", result.camera, result.method, error);
   }
-  client.receive_for(1s);
 
   std::vector<std::string> topics;
   for (auto& camera : cameras) {
@@ -61,38 +96,86 @@ int main(int argc, char* argv[]) {
   sr.entities = cameras;
   sr.sampling_rate = sample_rate;
   is::logger()->info("Sync request");
-  client.request("is.sync", is::msgpack(sr));
+  // is.sync is not a camera, but goes through the client as any other service
+  client.request("is", "sync", is::msgpack(sr), [](is::camera::Result const&) {});
+
+  std::unique_ptr<is::camera::MjpegServer> server;
+  if (vm.count("serve")) {
+    server.reset(new is::camera::MjpegServer(port));
+    is::logger()->info("Serving mjpeg stream on port {}", port);
+  }
+  auto headless = vm.count("headless") > 0;
 
   is::logger()->info("Starting capture");
 
-  while (1) {
-    auto images_msg = is.consume_sync(tag, topics, static_cast<int64_t>(1000.0 / fps));
-
-    std::vector<cv::Mat> up_frames, down_frames;
-    int n_frame = 0;
-    for (auto& msg : images_msg) {
-      auto image = is::msgpack<CompressedImage>(msg);
-      cv::Mat current_frame = cv::imdecode(image.data, CV_LOAD_IMAGE_COLOR);
-      cv::resize(current_frame, current_frame, cv::Size(current_frame.cols / 2, current_frame.rows / 2));
-      if (n_frame < 2) {
-        up_frames.push_back(current_frame);
-      } else {
-        down_frames.push_back(current_frame);
+  if (!vm.count("max-wait"))
+    max_wait = 1000.0 / fps;
+  if (!vm.count("tolerance"))
+    tolerance = 500.0 / fps;
+  is::camera::JitterBuffer jitter_buffer(topics, milliseconds(static_cast<int64_t>(max_wait)),
+                                         milliseconds(static_cast<int64_t>(tolerance)));
+  const cv::Size tile_size(resolution.width / 2, resolution.height / 2);
+
+  // Click on a tile (or press its number) to focus it, click it again (or press 0) to focus none. Press 'p' to pause
+  // decoding for the window: highgui reports minimized windows as visible, so that can't be detected.
+  is::camera::Tiles tiles(topics.size(), tile_size, policy);
+  const std::string window = "Intelligent Space";
+  if (!headless) {
+    cv::namedWindow(window, cv::WINDOW_AUTOSIZE);
+    cv::setMouseCallback(window,
+                         [](int event, int x, int y, int, void* data) {
+                           if (event != cv::EVENT_LBUTTONDOWN)
+                             return;
+                           auto tiles = static_cast<is::camera::Tiles*>(data);
+                           auto index = tiles->at(x, y);
+                           tiles->focus(index == tiles->focus() ? -1 : index);
+                         },
+                         &tiles);
+  }
+
+  bool paused = false;
+  auto handle_key = [&](int key) {
+    if (key >= '0' && key <= '9')
+      tiles.focus(key - '1');
+    if (key == 'p') {
+      paused = !paused;
+      is::logger()->info(paused ? "Paused" : "Resumed");
+    }
+  };
+
+  for (uint64_t n_set = 1;; ++n_set) {
+    tiles.update(jitter_buffer.next(is, tag));
+
+    if (n_set % 100 == 0) {
+      for (auto& stats : jitter_buffer.statistics()) {
+        is::logger()->info("{} lateness: mean {:.1f}ms, max {:.1f}ms, missing {}, dropped {}", stats.first,
+                           stats.second.mean_ms(), stats.second.max_ms, stats.second.missing, stats.second.dropped);
       }
-      n_frame++;
     }
 
-    cv::Mat output_image;
-    cv::Mat up_row, down_row;
-    std::vector<cv::Mat> rows_frames;
-    cv::hconcat(up_frames, up_row);
-    rows_frames.push_back(up_row);
-    cv::hconcat(down_frames, down_row);
-    rows_frames.push_back(down_row);
-    cv::vconcat(rows_frames, output_image);
-
-    cv::imshow("Intelligent Space", output_image);
-    cv::waitKey(1);
+    auto on_screen = !headless && !paused && cv::getWindowProperty(window, cv::WND_PROP_VISIBLE) > 0;
+    auto streaming = server != nullptr && server->clients() > 0;
+    auto frames = tiles.render(on_screen || streaming);
+    if (frames.empty()) {
+      if (!headless)
+        handle_key(cv::waitKey(1));
+      continue;
+    }
+
+    auto output_image = is::camera::make_mosaic(frames);
+
+    // encoded once per mosaic, whatever the number of clients
+    if (streaming) {
+      auto jpeg = std::make_shared<std::vector<unsigned char>>();
+      cv::imencode(".jpeg", output_image, *jpeg, {cv::IMWRITE_JPEG_QUALITY, quality});
+      server->publish(jpeg);
+    }
+
+    if (!headless && !paused) {
+      cv::imshow(window, output_image);
+    }
+    if (!headless)
+      handle_key(cv::waitKey(1));
   }
 
   is::logger()->info("Exiting");
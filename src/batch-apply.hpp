@@ -0,0 +1,167 @@
+#ifndef __BATCH_APPLY_HPP__
+#define __BATCH_APPLY_HPP__
+
+#include <yaml-cpp/yaml.h>
+#include <is/is.hpp>
+#include <is/msgs/camera.hpp>
+#include <is/msgs/common.hpp>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "camera-client.hpp"
+#include "properties.hpp"
+
+namespace is {
+namespace camera {
+namespace batch {
+
+using namespace std::chrono;
+using namespace is::msg::camera;
+using namespace is::msg::common;
+
+struct Update {
+  std::size_t line;
+  std::string camera;
+  Configuration configuration;
+};
+
+// Parses one update, validating every value against the ranges on properties.hpp. Lines are JSON objects:
+// {"camera": "ptgrey.0", "brightness": 2.0, "exposure": "auto", "shutter": 40, "gain": 10, "white_balance": [500, 700]}
+// where exposure, shutter, gain and white_balance also take "auto". Throws std::invalid_argument when invalid.
+inline Update parse_update(std::string const& text, std::size_t line) {
+  Update update;
+  update.line = line;
+  try {
+    auto node = YAML::Load(text);
+    if (!node.IsMap() || !node["camera"])
+      throw std::invalid_argument("expected an object with a camera");
+    for (auto&& field : node) {
+      auto key = field.first.as<std::string>();
+      auto value = field.second;
+      auto is_auto = value.IsScalar() && value.as<std::string>() == "auto";
+      if (key == "camera") {
+        update.camera = value.as<std::string>();
+      } else if (key == "brightness") {
+        check_range("Brightness", value.as<double>());
+        update.configuration.brightness = value.as<float>();
+      } else if (key == "exposure") {
+        Exposure exposure;
+        exposure.auto_mode = is_auto;
+        if (!is_auto) {
+          check_range("Exposure", value.as<double>());
+          exposure.value = value.as<float>();
+        }
+        update.configuration.exposure = exposure;
+      } else if (key == "shutter") {
+        Shutter shutter;
+        shutter.auto_mode = is_auto;
+        if (!is_auto) {
+          check_range("Shutter", value.as<double>());
+          shutter.percent = value.as<float>();
+        }
+        update.configuration.shutter = shutter;
+      } else if (key == "gain") {
+        Gain gain;
+        gain.auto_mode = is_auto;
+        if (!is_auto) {
+          check_range("Gain", value.as<double>());
+          gain.percent = value.as<float>();
+        }
+        update.configuration.gain = gain;
+      } else if (key == "white_balance") {
+        WhiteBalance white_balance;
+        white_balance.auto_mode = is_auto;
+        if (!is_auto) {
+          if (!value.IsSequence() || value.size() != 2)
+            throw std::invalid_argument("white_balance expects [red, blue] or \"auto\"");
+          check_range("WB[red]", value[0].as<double>());
+          check_range("WB[blue]", value[1].as<double>());
+          white_balance.red = value[0].as<unsigned int>();
+          white_balance.blue = value[1].as<unsigned int>();
+        }
+        update.configuration.white_balance = white_balance;
+      } else {
+        throw std::invalid_argument("unknown field " + key);
+      }
+    }
+  } catch (YAML::Exception& e) {
+    throw std::invalid_argument(e.what());
+  } catch (std::out_of_range& e) {
+    throw std::invalid_argument(e.what());
+  }
+  return update;
+}
+
+inline std::string escape(std::string const& text) {
+  std::string escaped;
+  for (auto c : text) {
+    if (c == '"' || c == '\\')
+      escaped += '\\';
+    escaped += c;
+  }
+  return escaped;
+}
+
+// Result of each update, reported as soon as it completes, as a JSON line.
+class Reporter {
+ public:
+  Reporter(std::ostream& out) : out(out) {}
+
+  void operator()(Update const& update, std::string const& status, double ms = 0.0) {
+    std::lock_guard<std::mutex> lock(mutex);
+    out << "{\"line\": " << update.line << ", \"camera\": \"" << escape(update.camera) << "\", \"status\": \""
+        << escape(status) << "\", \"ms\": " << ms << "}" << std::endl;
+    if (status == "ok")
+      ok++;
+    else
+      failed++;
+  }
+
+  std::size_t ok{0};
+  std::size_t failed{0};
+
+ private:
+  std::ostream& out;
+  std::mutex mutex;
+};
+
+// Reads updates, one per line, validating and sending them as they are read, so results stream back while the input
+// is still being read. Returns the number of updates that did not succeed.
+inline std::size_t apply(std::istream& in, std::ostream& out, std::string const& default_uri,
+                         std::string const& brokers_file, std::size_t max_in_flight, milliseconds timeout) {
+  Reporter report(out);
+  CameraClient client(default_uri, brokers_file, max_in_flight);
+  std::string text;
+  for (std::size_t line = 1; std::getline(in, text); ++line) {
+    if (text.find_first_not_of(" \t\r") == std::string::npos)
+      continue;
+    Update update;
+    try {
+      update = parse_update(text, line);
+    } catch (std::invalid_argument& e) {
+      Update invalid{line, "", Configuration()};
+      report(invalid, std::string("invalid: ") + e.what());
+      continue;
+    }
+    auto start = high_resolution_clock::now();
+    client.request(update.camera, "configure", is::msgpack(update.configuration),
+                   [&report, update, start](Result const& result) {
+                     auto error = error_of(result);
+                     report(update, error.empty() ? "ok" : error,
+                            duration<double, std::milli>(high_resolution_clock::now() - start).count());
+                   },
+                   timeout);
+  }
+  client.wait();
+  is::log::info("{} updates applied, {} failed", report.ok, report.failed);
+  return report.failed;
+}
+
+}  // ::batch
+}  // ::camera
+}  // ::is
+
+#endif  // __BATCH_APPLY_HPP__
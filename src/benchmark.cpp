@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <is/is.hpp>
+#include <is/msgs/camera.hpp>
+#include <is/msgs/common.hpp>
+#include <map>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui.hpp>
+#include <opencv2/imgproc.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "mosaic.hpp"
+#include "properties.hpp"
+#include "yaml-configure.hpp"
+
+namespace po = boost::program_options;
+using namespace std::chrono;
+using namespace is::msg::camera;
+using namespace is::msg::common;
+
+template <typename T>
+inline void do_not_optimize(T const& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result {
+  std::string name;
+  std::map<std::string, std::string> params;
+  uint64_t iterations;
+  double mean_ns;
+  double median_ns;
+  double min_ns;
+  double max_ns;
+  double stddev_ns;
+};
+
+// Runs 'f' in batches until 'min_time' has elapsed (and at least 'min_batches' batches were taken), keeping the
+// per-operation time of each batch as one sample.
+template <typename F>
+Result run(std::string const& name, std::map<std::string, std::string> const& params, F&& f,
+           duration<double> min_time, unsigned int min_batches = 5) {
+  f();  // warm up
+
+  // calibrate the batch size so each batch takes about 1/min_batches of the budget
+  uint64_t batch = 1;
+  for (;;) {
+    auto start = high_resolution_clock::now();
+    for (uint64_t i = 0; i < batch; ++i)
+      f();
+    duration<double> elapsed = high_resolution_clock::now() - start;
+    if (elapsed * min_batches >= min_time || batch >= (1u << 20))
+      break;
+    batch *= 2;
+  }
+
+  std::vector<double> samples;
+  uint64_t iterations = 0;
+  auto deadline = high_resolution_clock::now() + duration_cast<high_resolution_clock::duration>(min_time);
+  while (samples.size() < min_batches || high_resolution_clock::now() < deadline) {
+    auto start = high_resolution_clock::now();
+    for (uint64_t i = 0; i < batch; ++i)
+      f();
+    duration<double, std::nano> elapsed = high_resolution_clock::now() - start;
+    samples.push_back(elapsed.count() / batch);
+    iterations += batch;
+  }
+
+  Result result;
+  result.name = name;
+  result.params = params;
+  result.iterations = iterations;
+  std::sort(samples.begin(), samples.end());
+  result.min_ns = samples.front();
+  result.max_ns = samples.back();
+  result.median_ns = samples[samples.size() / 2];
+  double sum = 0.0;
+  for (auto& s : samples)
+    sum += s;
+  result.mean_ns = sum / samples.size();
+  double var = 0.0;
+  for (auto& s : samples)
+    var += (s - result.mean_ns) * (s - result.mean_ns);
+  result.stddev_ns = std::sqrt(var / samples.size());
+
+  std::cerr << name;
+  for (auto& p : params)
+    std::cerr << " " << p.first << "=" << p.second;
+  std::cerr << ": " << result.median_ns << " ns/op (" << iterations << " iterations)" << std::endl;
+  return result;
+}
+
+std::string to_json(std::vector<Result> const& results) {
+  std::ostringstream out;
+  out.precision(3);
+  out << std::fixed;
+  out << "{\n  \"benchmarks\": [\n";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    auto& r = results[i];
+    out << "    {\"name\": \"" << r.name << "\", \"params\": {";
+    std::size_t n = 0;
+    for (auto& p : r.params) {
+      out << (n++ ? ", " : "") << "\"" << p.first << "\": \"" << p.second << "\"";
+    }
+    out << "}, \"iterations\": " << r.iterations << ", \"mean_ns\": " << r.mean_ns
+        << ", \"median_ns\": " << r.median_ns << ", \"min_ns\": " << r.min_ns << ", \"max_ns\": " << r.max_ns
+        << ", \"stddev_ns\": " << r.stddev_ns << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+  return out.str();
+}
+
+// A configuration with every field filled, as returned by a camera on 'get_configuration'.
+Configuration full_configuration() {
+  Configuration config;
+  SamplingRate sampling_rate;
+  sampling_rate.rate = 5.0;
+  sampling_rate.period = 200.0;
+  config.sampling_rate = sampling_rate;
+  config.resolution = Resolution{1288, 728};
+  config.image_type = ImageType{"rgb"};
+  config.brightness = 1.367f;
+  Exposure exposure;
+  exposure.auto_mode = false;
+  exposure.value = 0.858f;
+  config.exposure = exposure;
+  Shutter shutter;
+  shutter.auto_mode = false;
+  shutter.percent = 50.0f;
+  shutter.ms = 20.0f;
+  config.shutter = shutter;
+  Gain gain;
+  gain.auto_mode = true;
+  gain.percent = 30.0f;
+  gain.db = 6.0f;
+  config.gain = gain;
+  WhiteBalance white_balance;
+  white_balance.auto_mode = false;
+  white_balance.red = 550;
+  white_balance.blue = 750;
+  config.white_balance = white_balance;
+  return config;
+}
+
+CompressedImage synthetic_image(int width, int height) {
+  cv::Mat frame(height, width, CV_8UC3);
+  cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+  CompressedImage image;
+  image.format = ".jpeg";
+  cv::imencode(image.format, frame, image.data);
+  return image;
+}
+
+is::Envelope::ptr_t as_envelope(is::Message::ptr_t const& message) {
+  return is::Envelope::Create(message, "", 0, "", false, "", 0);
+}
+
+int main(int argc, char* argv[]) {
+  std::string output;
+  double min_time_s;
+  std::vector<unsigned int> n_cameras;
+  const std::vector<unsigned int> default_n_cameras{10, 100, 1000, 10000};
+  std::string tmp_dir;
+
+  po::options_description description("Allowed options");
+  auto&& options = description.add_options();
+  options("help,", "show available options");
+  options("output,o", po::value<std::string>(&output), "json output file (default: stdout)");
+  options("min-time,t", po::value<double>(&min_time_s)->default_value(0.5), "minimum time per benchmark [s]");
+  options("cameras,c",
+          po::value<std::vector<unsigned int>>(&n_cameras)->multitoken()->default_value(default_n_cameras,
+                                                                                        "10 100 1000 10000"),
+          "number of cameras on yaml benchmarks");
+  options("tmp-dir,d", po::value<std::string>(&tmp_dir)->default_value("/tmp"), "directory for yaml files");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, description), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << description << std::endl;
+    return 1;
+  }
+
+  duration<double> min_time(min_time_s);
+  std::vector<Result> results;
+
+  // msgpack
+  auto configuration = full_configuration();
+  results.push_back(run("msgpack/encode", {{"type", "Configuration"}},
+                        [&]() { do_not_optimize(is::msgpack(configuration)); }, min_time));
+  auto configuration_msg = as_envelope(is::msgpack(configuration));
+  results.push_back(run("msgpack/decode", {{"type", "Configuration"}},
+                        [&]() { do_not_optimize(is::msgpack<Configuration>(configuration_msg)); }, min_time));
+
+  const std::vector<std::pair<int, int>> resolutions{{644, 364}, {1288, 728}};
+  for (auto& resolution : resolutions) {
+    auto image = synthetic_image(resolution.first, resolution.second);
+    std::map<std::string, std::string> params{
+        {"type", "CompressedImage"},
+        {"resolution", std::to_string(resolution.first) + "x" + std::to_string(resolution.second)},
+        {"bytes", std::to_string(image.data.size())}};
+    results.push_back(run("msgpack/encode", params, [&]() { do_not_optimize(is::msgpack(image)); }, min_time));
+    auto image_msg = as_envelope(is::msgpack(image));
+    results.push_back(
+        run("msgpack/decode", params, [&]() { do_not_optimize(is::msgpack<CompressedImage>(image_msg)); }, min_time));
+  }
+
+  // yaml
+  for (auto& n : n_cameras) {
+    std::map<std::string, Configuration> configurations;
+    for (unsigned int i = 0; i < n; ++i) {
+      configurations.emplace("ptgrey." + std::to_string(i), configuration);
+    }
+    auto filename = tmp_dir + "/is-benchmark-" + std::to_string(n) + ".yaml";
+    std::map<std::string, std::string> params{{"cameras", std::to_string(n)}};
+    results.push_back(run("yaml/from_configurations", params,
+                          [&]() { is::camera::configuration::from_configurations(configurations, filename); },
+                          min_time, 3));
+    results.push_back(run("yaml/from_file", params,
+                          [&]() { do_not_optimize(is::camera::configuration::from_file(filename)); }, min_time, 3));
+    std::remove(filename.c_str());
+  }
+
+  // slider conversions
+  for (auto& p : properties) {
+    auto property = p.first;
+    std::map<std::string, std::string> params{{"property", property}};
+    unsigned int value = 0;
+    results.push_back(run("properties/value_to_property", params,
+                          [&]() {
+                            value = (value + 1) % 1001;
+                            do_not_optimize(value_to_property.at(property)(value, 1000, false));
+                          },
+                          min_time));
+    results.push_back(run("properties/property_to_value", params,
+                          [&]() { do_not_optimize(property_to_value.at(property)(configuration, 1000)); },
+                          min_time));
+  }
+
+  // mosaic, with and without the decoding of each compressed frame
+  for (auto& resolution : resolutions) {
+    auto image = synthetic_image(resolution.first, resolution.second);
+    std::map<std::string, std::string> params{
+        {"cameras", "4"}, {"resolution", std::to_string(resolution.first) + "x" + std::to_string(resolution.second)}};
+    std::vector<cv::Mat> frames;
+    for (int i = 0; i < 4; ++i) {
+      cv::Mat frame = cv::imdecode(image.data, CV_LOAD_IMAGE_COLOR);
+      cv::resize(frame, frame, cv::Size(frame.cols / 2, frame.rows / 2));
+      frames.push_back(frame);
+    }
+    results.push_back(
+        run("mosaic/compose", params, [&]() { do_not_optimize(is::camera::make_mosaic(frames)); }, min_time));
+    results.push_back(run("mosaic/decode_compose", params,
+                          [&]() {
+                            std::vector<cv::Mat> frames;
+                            for (int i = 0; i < 4; ++i) {
+                              cv::Mat frame = cv::imdecode(image.data, CV_LOAD_IMAGE_COLOR);
+                              cv::resize(frame, frame, cv::Size(frame.cols / 2, frame.rows / 2));
+                              frames.push_back(frame);
+                            }
+                            do_not_optimize(is::camera::make_mosaic(frames));
+                          },
+                          min_time));
+  }
+
+  auto json = to_json(results);
+  if (vm.count("output")) {
+    std::ofstream file(output);
+    file << json;
+  } else {
+    std::cout << json;
+  }
+  return 0;
+}
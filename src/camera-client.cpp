@@ -0,0 +1,256 @@
+#include "camera-client.hpp"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include "rpc-metrics.hpp"
+
+namespace is {
+namespace camera {
+
+class CameraClient::Broker {
+  struct Pending {
+    std::string camera;
+    std::string method;
+    is::Message::ptr_t msg;
+    Callback callback;
+    high_resolution_clock::duration timeout;
+  };
+
+  struct InFlight {
+    std::string camera;
+    std::string method;
+    Callback callback;
+    high_resolution_clock::time_point deadline;
+  };
+
+ public:
+  Broker(std::string const& uri, std::size_t max_in_flight)
+      : connection(is::connect(uri)), client(is::make_client(connection)), max_in_flight(max_in_flight) {
+    thread = std::thread([this]() { run(); });
+  }
+
+  ~Broker() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    changed.notify_all();
+    thread.join();
+  }
+
+  void push(std::string const& camera, std::string const& method, is::Message::ptr_t const& msg, Callback callback,
+            high_resolution_clock::duration timeout) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      room.wait(lock, [this]() { return queue.size() < max_in_flight; });
+      queue.push_back(Pending{camera, method, msg, std::move(callback), timeout});
+    }
+    changed.notify_all();
+  }
+
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return queue.empty() && n_in_flight == 0; });
+  }
+
+ private:
+  void run() {
+    auto& metrics = rpc_metrics();
+    std::unordered_map<std::string, InFlight> in_flight;
+    for (;;) {
+      std::vector<Pending> to_send;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (in_flight.empty()) {
+          n_in_flight = 0;
+          if (queue.empty())
+            idle.notify_all();
+          changed.wait(lock, [this]() { return !queue.empty() || stopping; });
+          if (queue.empty())
+            return;
+        }
+        while (!queue.empty() && in_flight.size() + to_send.size() < max_in_flight) {
+          to_send.push_back(std::move(queue.front()));
+          queue.pop_front();
+        }
+        n_in_flight = in_flight.size() + to_send.size();
+      }
+      if (!to_send.empty())
+        room.notify_all();
+
+      for (auto& pending : to_send) {
+        auto id = metrics.request(client, pending.camera, pending.method, pending.msg);
+        in_flight.emplace(id, InFlight{pending.camera, pending.method, std::move(pending.callback),
+                                       high_resolution_clock::now() + pending.timeout});
+      }
+
+      // A short first poll, so requests queued meanwhile are not held back, then whatever else already arrived.
+      for (auto reply = metrics.receive_for(client, 1ms); reply != nullptr; reply = metrics.receive_for(client, 0ms)) {
+        auto request = in_flight.find(reply->Message()->CorrelationId());
+        if (request != in_flight.end()) {
+          done(request->second, reply);
+          in_flight.erase(request);
+        }
+      }
+      auto now = high_resolution_clock::now();
+      for (auto request = in_flight.begin(); request != in_flight.end();) {
+        if (now > request->second.deadline) {
+          metrics.expire(request->first);
+          done(request->second, nullptr);
+          request = in_flight.erase(request);
+        } else {
+          ++request;
+        }
+      }
+    }
+  }
+
+  static void done(InFlight const& request, is::Envelope::ptr_t const& reply) {
+    try {
+      request.callback(Result{request.camera, request.method, reply});
+    } catch (std::exception& e) {
+      is::log::warn("[{}|{}] callback failed: {}", request.camera, request.method, e.what());
+    }
+  }
+
+  is::Connection connection;
+  is::ServiceClient client;
+  std::size_t max_in_flight;
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::condition_variable room;
+  std::condition_variable idle;
+  std::deque<Pending> queue;
+  std::size_t n_in_flight{0};
+  bool stopping{false};
+  std::thread thread;
+};
+
+CameraClient::CameraClient(std::string const& default_uri, std::vector<shards::Rule> const& rules,
+                           std::size_t max_in_flight)
+    : default_uri(default_uri), rules(rules), max_in_flight(max_in_flight) {
+  if (max_in_flight < 1)
+    throw std::invalid_argument("camera client: max_in_flight must be at least 1");
+}
+
+CameraClient::CameraClient(std::string const& default_uri, std::string const& brokers_file,
+                           std::size_t max_in_flight)
+    : default_uri(default_uri), max_in_flight(max_in_flight) {
+  if (max_in_flight < 1)
+    throw std::invalid_argument("camera client: max_in_flight must be at least 1");
+  if (!brokers_file.empty()) {
+    rules = shards::load_rules(brokers_file);
+  }
+}
+
+CameraClient::~CameraClient() {
+  wait();
+}
+
+void CameraClient::request(std::string const& camera, std::string const& method, is::Message::ptr_t const& msg,
+                           Callback callback, high_resolution_clock::duration timeout) {
+  broker(camera).push(camera, method, msg, std::move(callback), timeout);
+}
+
+std::future<Result> CameraClient::request(std::string const& camera, std::string const& method,
+                                          is::Message::ptr_t const& msg, high_resolution_clock::duration timeout) {
+  auto promise = std::make_shared<std::promise<Result>>();
+  auto future = promise->get_future();
+  request(camera, method, msg, [promise](Result const& result) { promise->set_value(result); }, timeout);
+  return future;
+}
+
+std::map<std::string, Result> CameraClient::request(std::vector<std::string> const& cameras,
+                                                    std::string const& method, is::Message::ptr_t const& msg,
+                                                    high_resolution_clock::duration timeout) {
+  std::vector<std::future<Result>> futures;
+  for (auto& camera : cameras) {
+    futures.push_back(request(camera, method, msg, timeout));
+  }
+  std::map<std::string, Result> results;
+  for (auto& future : futures) {
+    auto result = future.get();
+    results.emplace(result.camera, result);
+  }
+  return results;
+}
+
+std::map<std::string, Configuration> CameraClient::get_configurations(std::vector<std::string> const& cameras,
+                                                                      high_resolution_clock::duration timeout) {
+  std::map<std::string, Configuration> configurations;
+  for (auto& result : request(cameras, "get_configuration", is::msgpack(0), timeout)) {
+    if (result.second.ok())
+      configurations.emplace(result.first, is::msgpack<Configuration>(result.second.reply));
+  }
+  return configurations;
+}
+
+std::map<std::string, std::string> CameraClient::set_configurations(
+    std::map<std::string, Configuration> const& configurations, std::string const& method,
+    high_resolution_clock::duration timeout) {
+  std::vector<std::future<Result>> futures;
+  for (auto& configuration : configurations) {
+    futures.push_back(request(configuration.first, method, is::msgpack(configuration.second), timeout));
+  }
+  std::map<std::string, std::string> errors;
+  for (auto& future : futures) {
+    auto result = future.get();
+    auto error = error_of(result);
+    if (!error.empty())
+      errors.emplace(result.camera, error);
+  }
+  return errors;
+}
+
+std::map<std::string, std::string> CameraClient::set_configuration(std::vector<std::string> const& cameras,
+                                                                   Configuration const& configuration,
+                                                                   std::string const& method,
+                                                                   high_resolution_clock::duration timeout) {
+  std::map<std::string, std::string> errors;
+  for (auto& result : request(cameras, method, is::msgpack(configuration), timeout)) {
+    auto error = error_of(result.second);
+    if (!error.empty())
+      errors.emplace(result.first, error);
+  }
+  return errors;
+}
+
+std::string CameraClient::broker_of(std::string const& camera) const {
+  return shards::broker_of(camera, rules, default_uri);
+}
+
+void CameraClient::wait() {
+  std::vector<Broker*> to_wait;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& broker : brokers) {
+      to_wait.push_back(broker.second.get());
+    }
+  }
+  for (auto broker : to_wait) {
+    broker->wait();
+  }
+}
+
+CameraClient::Broker& CameraClient::broker(std::string const& camera) {
+  auto uri = broker_of(camera);
+  std::lock_guard<std::mutex> lock(mutex);
+  auto broker = brokers.find(uri);
+  if (broker == brokers.end()) {
+    broker = brokers.emplace(uri, std::unique_ptr<Broker>(new Broker(uri, max_in_flight))).first;
+  }
+  return *(broker->second);
+}
+
+std::string error_of(Result const& result) {
+  if (!result.ok())
+    return "timeout";
+  auto status = is::msgpack<Status>(result.reply);
+  return status.value == status::ok.value ? "" : status.value;
+}
+
+}  // ::camera
+}  // ::is
@@ -0,0 +1,95 @@
+#ifndef __CAMERA_CLIENT_HPP__
+#define __CAMERA_CLIENT_HPP__
+
+#include <is/is.hpp>
+#include <is/msgs/camera.hpp>
+#include <is/msgs/common.hpp>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "shards.hpp"
+
+namespace is {
+namespace camera {
+
+using namespace std::chrono;
+using namespace is::msg::camera;
+using namespace is::msg::common;
+
+// Outcome of a request to a camera, 'reply' is empty when none arrived until the deadline.
+struct Result {
+  std::string camera;
+  std::string method;
+  is::Envelope::ptr_t reply;
+
+  bool ok() const { return reply != nullptr; }
+};
+
+using Callback = std::function<void(Result const&)>;
+
+// Asynchronous client for the services of cameras spread over one or more brokers. Every broker gets a single
+// connection, opened on the first request to one of its cameras and shared by every thread using the client, and a
+// thread of its own that keeps up to 'max_in_flight' requests pending, matches replies back to them by correlation id
+// and expires the ones past their deadline. Up to 'max_in_flight' more wait their turn, further requests block the
+// caller until there is room. Round trips are recorded on rpc_metrics().
+class CameraClient {
+ public:
+  CameraClient(std::string const& default_uri, std::vector<shards::Rule> const& rules = {},
+               std::size_t max_in_flight = 256);
+  // Cameras are mapped to brokers as on shards::load_rules, an empty 'brokers_file' maps all to 'default_uri'.
+  CameraClient(std::string const& default_uri, std::string const& brokers_file, std::size_t max_in_flight = 256);
+  // Waits for the pending requests.
+  ~CameraClient();
+
+  CameraClient(CameraClient const&) = delete;
+  CameraClient& operator=(CameraClient const&) = delete;
+
+  // Requests 'camera'.'method'. 'callback' runs on the thread of the broker once the reply arrives or 'timeout' passes
+  // since the request was sent, so it should be short and must neither make nor wait on other requests.
+  void request(std::string const& camera, std::string const& method, is::Message::ptr_t const& msg, Callback callback,
+               high_resolution_clock::duration timeout = 1s);
+  std::future<Result> request(std::string const& camera, std::string const& method, is::Message::ptr_t const& msg,
+                              high_resolution_clock::duration timeout = 1s);
+
+  // Batched requests: all of them are sent at once, so brokers are queried in parallel, and collected by camera.
+  std::map<std::string, Result> request(std::vector<std::string> const& cameras, std::string const& method,
+                                        is::Message::ptr_t const& msg, high_resolution_clock::duration timeout = 1s);
+  // Cameras that did not reply in time are left out.
+  std::map<std::string, Configuration> get_configurations(std::vector<std::string> const& cameras,
+                                                          high_resolution_clock::duration timeout = 1s);
+  // Both return the error of every camera that failed: "timeout" or the status it replied with.
+  std::map<std::string, std::string> set_configurations(std::map<std::string, Configuration> const& configurations,
+                                                        std::string const& method = "set_configuration",
+                                                        high_resolution_clock::duration timeout = 1s);
+  std::map<std::string, std::string> set_configuration(std::vector<std::string> const& cameras,
+                                                       Configuration const& configuration,
+                                                       std::string const& method = "set_configuration",
+                                                       high_resolution_clock::duration timeout = 1s);
+
+  std::string broker_of(std::string const& camera) const;
+  // Blocks until every request made so far is done.
+  void wait();
+
+ private:
+  class Broker;
+  Broker& broker(std::string const& camera);
+
+  std::string default_uri;
+  std::vector<shards::Rule> rules;
+  std::size_t max_in_flight;
+  std::mutex mutex;
+  std::map<std::string, std::unique_ptr<Broker>> brokers;
+};
+
+// Error of a reply to one of the set methods, empty when the camera replied ok.
+std::string error_of(Result const& result);
+
+}  // ::camera
+}  // ::is
+
+#endif  // __CAMERA_CLIENT_HPP__
@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <atomic>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <is/is.hpp>
+#include <is/msgs/camera.hpp>
+#include <is/msgs/common.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui.hpp>
+#include <opencv2/imgproc.hpp>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace po = boost::program_options;
+using namespace std::chrono;
+using namespace is::msg::camera;
+using namespace is::msg::common;
+
+struct VirtualCamera {
+  std::string name;
+  Configuration configuration;
+  std::mutex mutex;
+  // encoded frame for the current resolution/type, rebuilt when any of them changes
+  std::shared_ptr<CompressedImage> frame;
+  uint64_t n_frames{0};
+};
+
+struct Network {
+  milliseconds latency;
+  milliseconds jitter;
+  double loss;
+};
+
+Configuration default_configuration() {
+  Configuration config;
+  SamplingRate sampling_rate;
+  sampling_rate.rate = 5.0;
+  sampling_rate.period = 200.0;
+  config.sampling_rate = sampling_rate;
+  config.resolution = Resolution{1288, 728};
+  config.image_type = ImageType{"rgb"};
+  config.brightness = 1.367f;
+  Exposure exposure;
+  exposure.auto_mode = true;
+  exposure.value = 0.858f;
+  config.exposure = exposure;
+  Shutter shutter;
+  shutter.auto_mode = true;
+  shutter.percent = 50.0f;
+  shutter.ms = 20.0f;
+  config.shutter = shutter;
+  Gain gain;
+  gain.auto_mode = true;
+  gain.percent = 30.0f;
+  gain.db = 6.0f;
+  config.gain = gain;
+  WhiteBalance white_balance;
+  white_balance.auto_mode = true;
+  white_balance.red = 550;
+  white_balance.blue = 750;
+  config.white_balance = white_balance;
+  return config;
+}
+
+// Applies every field present on 'update' the way the camera gateway does: manual values are kept when only the mode
+// is sent, and the period is derived from the rate (and vice versa).
+void merge(Configuration& config, Configuration const& update) {
+  if (update.sampling_rate) {
+    SamplingRate sampling_rate;
+    auto& rate = *(update.sampling_rate);
+    if (rate.rate) {
+      sampling_rate.rate = *(rate.rate);
+      sampling_rate.period = 1000.0 / *(rate.rate);
+    } else if (rate.period) {
+      sampling_rate.period = *(rate.period);
+      sampling_rate.rate = 1000.0 / *(rate.period);
+    }
+    if (sampling_rate.rate)
+      config.sampling_rate = sampling_rate;
+  }
+  if (update.resolution)
+    config.resolution = update.resolution;
+  if (update.image_type)
+    config.image_type = update.image_type;
+  if (update.brightness)
+    config.brightness = update.brightness;
+  if (update.exposure) {
+    auto exposure = *(config.exposure);
+    auto& value = *(update.exposure);
+    exposure.auto_mode = value.auto_mode ? *(value.auto_mode) : false;
+    if (!*(exposure.auto_mode))
+      exposure.value = value.value;
+    config.exposure = exposure;
+  }
+  if (update.shutter) {
+    auto shutter = *(config.shutter);
+    auto& value = *(update.shutter);
+    shutter.auto_mode = value.auto_mode ? *(value.auto_mode) : false;
+    if (value.percent)
+      shutter.percent = value.percent;
+    if (value.ms)
+      shutter.ms = value.ms;
+    config.shutter = shutter;
+  }
+  if (update.gain) {
+    auto gain = *(config.gain);
+    auto& value = *(update.gain);
+    gain.auto_mode = value.auto_mode ? *(value.auto_mode) : false;
+    if (value.percent)
+      gain.percent = value.percent;
+    if (value.db)
+      gain.db = value.db;
+    config.gain = gain;
+  }
+  if (update.white_balance) {
+    auto white_balance = *(config.white_balance);
+    auto& value = *(update.white_balance);
+    white_balance.auto_mode = value.auto_mode ? *(value.auto_mode) : false;
+    if (value.red)
+      white_balance.red = value.red;
+    if (value.blue)
+      white_balance.blue = value.blue;
+    config.white_balance = white_balance;
+  }
+}
+
+std::shared_ptr<CompressedImage> make_frame(std::string const& name, Configuration const& config, uint64_t n_frame,
+                                            int quality) {
+  auto resolution = *(config.resolution);
+  auto gray = (*(config.image_type)).value == "gray";
+  cv::Mat frame(resolution.height, resolution.width, gray ? CV_8UC1 : CV_8UC3, cv::Scalar(64, 128, 192));
+  cv::putText(frame, name + " #" + std::to_string(n_frame), cv::Point(20, resolution.height / 2),
+              cv::FONT_HERSHEY_SIMPLEX, 2.0, cv::Scalar(255, 255, 255), 3);
+  auto image = std::make_shared<CompressedImage>();
+  image->format = ".jpeg";
+  cv::imencode(image->format, frame, image->data, {cv::IMWRITE_JPEG_QUALITY, quality});
+  return image;
+}
+
+int main(int argc, char* argv[]) {
+  std::string uri;
+  std::vector<std::string> cameras;
+  std::string prefix;
+  unsigned int n_cameras;
+  unsigned int latency_ms, jitter_ms;
+  double loss;
+  int quality;
+
+  po::options_description description("Allowed options");
+  auto&& options = description.add_options();
+  options("help,", "show available options");
+  options("uri,u", po::value<std::string>(&uri)->default_value("amqp://localhost"), "broker uri");
+  options("cameras,c", po::value<std::vector<std::string>>(&cameras)->multitoken(), "cameras");
+  options("n-cameras,n", po::value<unsigned int>(&n_cameras)->default_value(4),
+          "number of cameras, used when no names are given");
+  options("prefix,p", po::value<std::string>(&prefix)->default_value("ptgrey."), "camera name prefix");
+  options("latency,l", po::value<unsigned int>(&latency_ms)->default_value(5), "reply latency [ms]");
+  options("jitter,j", po::value<unsigned int>(&jitter_ms)->default_value(2), "reply jitter [ms]");
+  options("loss", po::value<double>(&loss)->default_value(0.0),
+          "probability of a lost reply, independent for every request [0~1]");
+  options("quality,q", po::value<int>(&quality)->default_value(80), "jpeg quality [0~100]");
+  options("animate", "encodes a new frame on every publish instead of reusing it");
+  options("sync", "also serves a no-op is.sync");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, description), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << description << std::endl;
+    return 1;
+  }
+
+  if (!vm.count("cameras")) {
+    for (unsigned int i = 0; i < n_cameras; ++i) {
+      cameras.push_back(prefix + std::to_string(i));
+    }
+  }
+
+  Network network{milliseconds(latency_ms), milliseconds(jitter_ms), loss};
+  auto animate = vm.count("animate") > 0;
+
+  std::vector<std::unique_ptr<VirtualCamera>> virtual_cameras;
+  for (auto& camera : cameras) {
+    virtual_cameras.emplace_back(new VirtualCamera);
+    virtual_cameras.back()->name = camera;
+    virtual_cameras.back()->configuration = default_configuration();
+  }
+
+  auto update = [](VirtualCamera& camera, Configuration const& config) {
+    std::lock_guard<std::mutex> lock(camera.mutex);
+    merge(camera.configuration, config);
+    camera.frame.reset();
+  };
+
+  std::map<std::string, std::function<is::Reply(VirtualCamera&, is::Request)>> methods{
+      {"set_configuration",
+       [=](VirtualCamera& camera, is::Request request) -> is::Reply {
+         update(camera, is::msgpack<Configuration>(request));
+         return is::msgpack(status::ok);
+       }},
+      {"get_configuration",
+       [](VirtualCamera& camera, is::Request) -> is::Reply {
+         std::lock_guard<std::mutex> lock(camera.mutex);
+         return is::msgpack(camera.configuration);
+       }},
+      {"set_sample_rate",
+       [=](VirtualCamera& camera, is::Request request) -> is::Reply {
+         Configuration config;
+         config.sampling_rate = is::msgpack<SamplingRate>(request);
+         update(camera, config);
+         return is::msgpack(status::ok);
+       }},
+      {"set_resolution",
+       [=](VirtualCamera& camera, is::Request request) -> is::Reply {
+         Configuration config;
+         config.resolution = is::msgpack<Resolution>(request);
+         update(camera, config);
+         return is::msgpack(status::ok);
+       }},
+      {"set_image_type",
+       [=](VirtualCamera& camera, is::Request request) -> is::Reply {
+         Configuration config;
+         config.image_type = is::msgpack<ImageType>(request);
+         update(camera, config);
+         return is::msgpack(status::ok);
+       }},
+  };
+  // set-parameters still uses the old name
+  methods.emplace("configure", methods.at("set_configuration"));
+
+  // Every camera serves its requests one at a time, as the gateway does, replying like is::advertise: on the reply_to
+  // of the request with its correlation id. A lost reply is never sent, so it doesn't hold back the ones behind it.
+  std::vector<std::thread> services;
+  for (auto& vc : virtual_cameras) {
+    auto camera = vc.get();
+    services.emplace_back([&uri, &methods, network, camera]() {
+      auto is = is::connect(uri);
+      std::vector<std::string> topics;
+      for (auto& method : methods) {
+        topics.push_back(camera->name + "." + method.first);
+      }
+      auto tag = is.subscribe(topics);
+      std::mt19937 rng(std::hash<std::string>()(camera->name));
+      std::uniform_real_distribution<double> uniform(0.0, 1.0);
+      for (;;) {
+        auto request = is.consume(tag);
+        auto jitter = network.jitter.count() * (2.0 * uniform(rng) - 1.0);
+        std::this_thread::sleep_for(duration<double, std::milli>(std::max(0.0, network.latency.count() + jitter)));
+
+        auto topic = request->RoutingKey();
+        auto reply = methods.at(topic.substr(camera->name.size() + 1))(*camera, request);
+        if (network.loss > 0.0 && uniform(rng) < network.loss)
+          continue;
+        reply->CorrelationId(request->Message()->CorrelationId());
+        is.publish(request->Message()->ReplyTo(), reply);
+      }
+    });
+  }
+
+  if (vm.count("sync")) {
+    services.push_back(
+        is::advertise(uri, "is", {{"sync", [](is::Request) -> is::Reply { return is::msgpack(status::ok); }}}));
+  }
+
+  is::log::info("Serving {} cameras [latency: {}ms, jitter: {}ms, loss: {}]", cameras.size(), latency_ms, jitter_ms,
+                loss);
+
+  // Frames of every camera are published from a single connection, scheduled by the time of their next frame.
+  auto is = is::connect(uri);
+  using Entry = std::pair<high_resolution_clock::time_point, VirtualCamera*>;
+  auto later = [](Entry const& lhs, Entry const& rhs) { return lhs.first > rhs.first; };
+  std::priority_queue<Entry, std::vector<Entry>, decltype(later)> schedule(later);
+  auto now = high_resolution_clock::now();
+  for (auto& vc : virtual_cameras) {
+    schedule.push(std::make_pair(now, vc.get()));
+  }
+
+  while (1) {
+    auto next = schedule.top();
+    schedule.pop();
+    std::this_thread::sleep_until(next.first);
+
+    auto camera = next.second;
+    std::shared_ptr<CompressedImage> frame;
+    double rate;
+    {
+      std::lock_guard<std::mutex> lock(camera->mutex);
+      if (camera->frame == nullptr || animate) {
+        camera->frame = make_frame(camera->name, camera->configuration, camera->n_frames, quality);
+      }
+      frame = camera->frame;
+      rate = *((*(camera->configuration.sampling_rate)).rate);
+      camera->n_frames++;
+    }
+    is.publish(camera->name + ".frame", is::msgpack(*frame));
+
+    auto period = duration_cast<high_resolution_clock::duration>(duration<double>(1.0 / std::max(rate, 0.1)));
+    // keep the frame grid, unless we fell behind by more than a period
+    auto at = std::max(next.first + period, high_resolution_clock::now() - period);
+    schedule.push(std::make_pair(at, camera));
+  }
+
+  for (auto& service : services) {
+    service.join();
+  }
+  return 0;
+}
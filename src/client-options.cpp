@@ -0,0 +1,44 @@
+#include "client-options.hpp"
+#include "rpc-metrics.hpp"
+
+namespace po = boost::program_options;
+
+namespace is {
+namespace camera {
+
+void ClientOptions::add_uri(po::options_description& description, std::string const& default_uri) {
+  description.add_options()("uri,u", po::value<std::string>(&uri)->default_value(default_uri), "broker uri");
+}
+
+void ClientOptions::add_cameras(po::options_description& description, std::vector<std::string> const& defaults) {
+  auto value = po::value<std::vector<std::string>>(&cameras)->multitoken();
+  if (!defaults.empty()) {
+    std::string text;
+    for (auto& camera : defaults) {
+      text += (text.empty() ? "" : " ") + camera;
+    }
+    value->default_value(defaults, text);
+  }
+  description.add_options()("cameras,c", value, "cameras");
+}
+
+void ClientOptions::add_brokers(po::options_description& description, char const* name) {
+  description.add_options()(name, po::value<std::string>(&brokers_file), "camera to broker mapping file (yaml)");
+}
+
+void ClientOptions::add_metrics(po::options_description& description, std::string const& help) {
+  description.add_options()("metrics-file", po::value<std::string>(&metrics_file), help.c_str());
+}
+
+void ClientOptions::write_metrics() const {
+  if (!metrics_file.empty())
+    rpc_metrics().write_prometheus(metrics_file);
+}
+
+void ClientOptions::report() const {
+  rpc_metrics().summary();
+  write_metrics();
+}
+
+}  // ::camera
+}  // ::is
@@ -0,0 +1,36 @@
+#ifndef __CLIENT_OPTIONS_HPP__
+#define __CLIENT_OPTIONS_HPP__
+
+#include <boost/program_options.hpp>
+#include <string>
+#include <vector>
+
+namespace is {
+namespace camera {
+
+// Command line options shared by the tools talking to cameras, and what all of them do with the metrics on exit.
+struct ClientOptions {
+  std::string uri;
+  std::vector<std::string> cameras;
+  std::string brokers_file;
+  std::string metrics_file;
+
+  void add_uri(boost::program_options::options_description& description,
+               std::string const& default_uri = "amqp://localhost");
+  void add_cameras(boost::program_options::options_description& description,
+                   std::vector<std::string> const& defaults = {});
+  // 'name' is "brokers" on tools using -b for something else.
+  void add_brokers(boost::program_options::options_description& description, char const* name = "brokers,b");
+  void add_metrics(boost::program_options::options_description& description,
+                   std::string const& help = "writes request metrics (prometheus text format)");
+
+  // Writes the request metrics on the metrics file, when one was given.
+  void write_metrics() const;
+  // Logs the request metrics summary and writes them.
+  void report() const;
+};
+
+}  // ::camera
+}  // ::is
+
+#endif  // __CLIENT_OPTIONS_HPP__
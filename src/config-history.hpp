@@ -0,0 +1,327 @@
+#ifndef __CONFIG_HISTORY_HPP__
+#define __CONFIG_HISTORY_HPP__
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <is/msgs/camera.hpp>
+#include <is/msgs/common.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace is {
+namespace camera {
+namespace history {
+
+using namespace is::msg::common;
+using namespace is::msg::camera;
+
+// Fixed layout of one configuration sample. Fields not present on the sample are flagged off on 'present'.
+struct Record {
+  enum Field : uint16_t {
+    RATE = 1 << 0,
+    RESOLUTION = 1 << 1,
+    IMAGE_TYPE = 1 << 2,
+    BRIGHTNESS = 1 << 3,
+    EXPOSURE = 1 << 4,
+    SHUTTER_PERCENT = 1 << 5,
+    SHUTTER_MS = 1 << 6,
+    GAIN_PERCENT = 1 << 7,
+    GAIN_DB = 1 << 8,
+    WB_RED = 1 << 9,
+    WB_BLUE = 1 << 10,
+  };
+  enum Mode : uint8_t { EXPOSURE_AUTO = 1 << 0, SHUTTER_AUTO = 1 << 1, GAIN_AUTO = 1 << 2, WB_AUTO = 1 << 3 };
+
+  int64_t timestamp;  // [ms] since epoch
+  uint16_t present;
+  uint8_t modes;
+  uint8_t reserved;
+  uint16_t width;
+  uint16_t height;
+  char image_type[8];
+  float rate;
+  float brightness;
+  float exposure;
+  float shutter_percent;
+  float shutter_ms;
+  float gain_percent;
+  float gain_db;
+  uint16_t wb_red;
+  uint16_t wb_blue;
+  uint8_t padding[8];
+};
+static_assert(sizeof(Record) == 64, "history records must keep their on-disk layout");
+
+inline Record to_record(int64_t timestamp, Configuration const& config) {
+  Record record;
+  std::memset(&record, 0, sizeof(record));
+  record.timestamp = timestamp;
+  if (config.sampling_rate && (*(config.sampling_rate)).rate) {
+    record.present |= Record::RATE;
+    record.rate = static_cast<float>(*((*(config.sampling_rate)).rate));
+  }
+  if (config.resolution) {
+    record.present |= Record::RESOLUTION;
+    record.width = static_cast<uint16_t>((*(config.resolution)).width);
+    record.height = static_cast<uint16_t>((*(config.resolution)).height);
+  }
+  if (config.image_type) {
+    record.present |= Record::IMAGE_TYPE;
+    std::strncpy(record.image_type, (*(config.image_type)).value.c_str(), sizeof(record.image_type) - 1);
+  }
+  if (config.brightness) {
+    record.present |= Record::BRIGHTNESS;
+    record.brightness = *(config.brightness);
+  }
+  if (config.exposure) {
+    auto& exposure = *(config.exposure);
+    record.present |= Record::EXPOSURE;
+    record.exposure = exposure.value;
+    if (exposure.auto_mode && *(exposure.auto_mode))
+      record.modes |= Record::EXPOSURE_AUTO;
+  }
+  if (config.shutter) {
+    auto& shutter = *(config.shutter);
+    if (shutter.percent) {
+      record.present |= Record::SHUTTER_PERCENT;
+      record.shutter_percent = *(shutter.percent);
+    }
+    if (shutter.ms) {
+      record.present |= Record::SHUTTER_MS;
+      record.shutter_ms = *(shutter.ms);
+    }
+    if (shutter.auto_mode && *(shutter.auto_mode))
+      record.modes |= Record::SHUTTER_AUTO;
+  }
+  if (config.gain) {
+    auto& gain = *(config.gain);
+    if (gain.percent) {
+      record.present |= Record::GAIN_PERCENT;
+      record.gain_percent = *(gain.percent);
+    }
+    if (gain.db) {
+      record.present |= Record::GAIN_DB;
+      record.gain_db = *(gain.db);
+    }
+    if (gain.auto_mode && *(gain.auto_mode))
+      record.modes |= Record::GAIN_AUTO;
+  }
+  if (config.white_balance) {
+    auto& white_balance = *(config.white_balance);
+    if (white_balance.red) {
+      record.present |= Record::WB_RED;
+      record.wb_red = static_cast<uint16_t>(*(white_balance.red));
+    }
+    if (white_balance.blue) {
+      record.present |= Record::WB_BLUE;
+      record.wb_blue = static_cast<uint16_t>(*(white_balance.blue));
+    }
+    if (white_balance.auto_mode && *(white_balance.auto_mode))
+      record.modes |= Record::WB_AUTO;
+  }
+  return record;
+}
+
+inline Configuration to_configuration(Record const& record) {
+  Configuration config;
+  if (record.present & Record::RATE) {
+    SamplingRate sampling_rate;
+    sampling_rate.rate = record.rate;
+    config.sampling_rate = sampling_rate;
+  }
+  if (record.present & Record::RESOLUTION) {
+    config.resolution = Resolution{record.width, record.height};
+  }
+  if (record.present & Record::IMAGE_TYPE) {
+    auto length = strnlen(record.image_type, sizeof(record.image_type));
+    config.image_type = ImageType{std::string(record.image_type, length)};
+  }
+  if (record.present & Record::BRIGHTNESS) {
+    config.brightness = record.brightness;
+  }
+  if (record.present & Record::EXPOSURE) {
+    Exposure exposure;
+    exposure.auto_mode = (record.modes & Record::EXPOSURE_AUTO) != 0;
+    exposure.value = record.exposure;
+    config.exposure = exposure;
+  }
+  if (record.present & (Record::SHUTTER_PERCENT | Record::SHUTTER_MS)) {
+    Shutter shutter;
+    shutter.auto_mode = (record.modes & Record::SHUTTER_AUTO) != 0;
+    if (record.present & Record::SHUTTER_PERCENT)
+      shutter.percent = record.shutter_percent;
+    if (record.present & Record::SHUTTER_MS)
+      shutter.ms = record.shutter_ms;
+    config.shutter = shutter;
+  }
+  if (record.present & (Record::GAIN_PERCENT | Record::GAIN_DB)) {
+    Gain gain;
+    gain.auto_mode = (record.modes & Record::GAIN_AUTO) != 0;
+    if (record.present & Record::GAIN_PERCENT)
+      gain.percent = record.gain_percent;
+    if (record.present & Record::GAIN_DB)
+      gain.db = record.gain_db;
+    config.gain = gain;
+  }
+  if (record.present & (Record::WB_RED | Record::WB_BLUE)) {
+    WhiteBalance white_balance;
+    white_balance.auto_mode = (record.modes & Record::WB_AUTO) != 0;
+    if (record.present & Record::WB_RED)
+      white_balance.red = record.wb_red;
+    if (record.present & Record::WB_BLUE)
+      white_balance.blue = record.wb_blue;
+    config.white_balance = white_balance;
+  }
+  return config;
+}
+
+// Memory mapped file holding one ring of 'capacity' records per camera:
+// [Header][Ring camera 0][records camera 0][Ring camera 1][records camera 1]...
+// Appending writes a single record in place, so memory use and the cost of a sample don't grow with time.
+class ConfigHistory {
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t n_cameras;
+    uint64_t capacity;
+  };
+
+  struct Ring {
+    char name[56];
+    uint64_t next;  // total number of records ever appended
+  };
+
+ public:
+  // Opens an existing history read only, or for writing when 'cameras' are given, creating it when the file does not
+  // exist. An existing file must hold exactly 'cameras' and 'capacity'.
+  ConfigHistory(std::string const& filename, std::vector<std::string> const& cameras = {}, uint64_t capacity = 0)
+      : read_only(cameras.empty()) {
+    fd = ::open(filename.c_str(), read_only ? O_RDONLY : O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+      throw std::runtime_error("history: unable to open " + filename);
+    struct stat st;
+    ::fstat(fd, &st);
+    auto create = st.st_size == 0;
+    if (create) {
+      if (read_only || capacity == 0)
+        throw std::runtime_error("history: " + filename + " does not exist, cameras and capacity are required");
+      size = file_size(cameras.size(), capacity);
+      if (::ftruncate(fd, size) < 0)
+        throw std::runtime_error("history: unable to allocate " + filename);
+    } else {
+      size = static_cast<std::size_t>(st.st_size);
+    }
+    auto protection = read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+    base = static_cast<char*>(::mmap(nullptr, size, protection, MAP_SHARED, fd, 0));
+    if (base == MAP_FAILED)
+      throw std::runtime_error("history: unable to map " + filename);
+
+    auto header = reinterpret_cast<Header*>(base);
+    if (create) {
+      std::memcpy(header->magic, "ISCFGHST", 8);
+      header->version = 1;
+      header->n_cameras = static_cast<uint32_t>(cameras.size());
+      header->capacity = capacity;
+      for (std::size_t i = 0; i < cameras.size(); ++i) {
+        std::strncpy(ring(i)->name, cameras[i].c_str(), sizeof(Ring::name) - 1);
+      }
+    } else if (size < sizeof(Header) || std::memcmp(header->magic, "ISCFGHST", 8) != 0 || header->version != 1 ||
+               size != file_size(header->n_cameras, header->capacity)) {
+      throw std::runtime_error("history: " + filename + " is not a configuration history");
+    }
+    for (std::size_t i = 0; i < header->n_cameras; ++i) {
+      index.emplace(ring(i)->name, i);
+    }
+
+    if (!create && !read_only) {
+      auto requested = std::set<std::string>(cameras.begin(), cameras.end());
+      auto stored = this->cameras();
+      if (requested != std::set<std::string>(stored.begin(), stored.end()) || capacity != header->capacity) {
+        throw std::runtime_error("history: " + filename + " was created for other cameras or capacity (" +
+                                 std::to_string(stored.size()) + " cameras, " + std::to_string(header->capacity) +
+                                 " samples each), use another file");
+      }
+    }
+  }
+
+  ~ConfigHistory() {
+    ::munmap(base, size);
+    ::close(fd);
+  }
+
+  ConfigHistory(ConfigHistory const&) = delete;
+  ConfigHistory& operator=(ConfigHistory const&) = delete;
+
+  std::vector<std::string> cameras() const {
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < n_cameras(); ++i) {
+      names.push_back(ring(i)->name);
+    }
+    return names;
+  }
+
+  bool append(std::string const& camera, int64_t timestamp, Configuration const& config) {
+    auto camera_index = index.find(camera);
+    if (read_only || camera_index == index.end())
+      return false;
+    auto r = ring(camera_index->second);
+    records(camera_index->second)[r->next % capacity()] = to_record(timestamp, config);
+    r->next++;
+    return true;
+  }
+
+  // Samples of 'camera' with from <= timestamp <= to, oldest first.
+  std::vector<std::pair<int64_t, Configuration>> query(std::string const& camera, int64_t from, int64_t to) const {
+    std::vector<std::pair<int64_t, Configuration>> samples;
+    auto camera_index = index.find(camera);
+    if (camera_index == index.end())
+      return samples;
+    auto r = ring(camera_index->second);
+    auto first = r->next > capacity() ? r->next - capacity() : 0;
+    for (auto n = first; n < r->next; ++n) {
+      auto& record = records(camera_index->second)[n % capacity()];
+      if (record.timestamp >= from && record.timestamp <= to)
+        samples.emplace_back(record.timestamp, to_configuration(record));
+    }
+    return samples;
+  }
+
+  void flush() {
+    if (!read_only)
+      ::msync(base, size, MS_ASYNC);
+  }
+
+ private:
+  static std::size_t ring_size(uint64_t capacity) { return sizeof(Ring) + capacity * sizeof(Record); }
+  static std::size_t file_size(std::size_t n_cameras, uint64_t capacity) {
+    return sizeof(Header) + n_cameras * ring_size(capacity);
+  }
+
+  std::size_t n_cameras() const { return reinterpret_cast<Header const*>(base)->n_cameras; }
+  uint64_t capacity() const { return reinterpret_cast<Header const*>(base)->capacity; }
+  Ring* ring(std::size_t i) const {
+    return reinterpret_cast<Ring*>(base + sizeof(Header) + i * ring_size(capacity()));
+  }
+  Record* records(std::size_t i) const { return reinterpret_cast<Record*>(ring(i) + 1); }
+
+  bool read_only;
+  int fd;
+  std::size_t size;
+  char* base;
+  std::map<std::string, std::size_t> index;
+};
+
+}  // ::history
+}  // ::camera
+}  // ::is
+
+#endif  // __CONFIG_HISTORY_HPP__
@@ -1,30 +1,46 @@
-#include <boost/iterator/zip_iterator.hpp>
 #include <boost/program_options.hpp>
-#include <boost/tuple/tuple.hpp>
+#include <atomic>
 #include <chrono>
+#include <csignal>
 #include <iostream>
 #include <is/is.hpp>
 #include <is/msgs/camera.hpp>
 #include <is/msgs/common.hpp>
 #include <string>
+#include <thread>
 #include <vector>
+#include "camera-client.hpp"
+#include "client-options.hpp"
+#include "config-history.hpp"
 #include "yaml-configure.hpp"
 
 namespace po = boost::program_options;
 using namespace is::msg::camera;
 using namespace is::msg::common;
 
+std::atomic_bool running{true};
+
 int main(int argc, char* argv[]) {
-  std::string uri;
-  std::vector<std::string> cameras;
+  is::camera::ClientOptions common;
   std::string yaml_file;
+  double rate;
+  std::string history_file;
+  uint64_t capacity;
 
   po::options_description description("Allowed options");
   auto&& options = description.add_options();
   options("help,", "show available options");
-  options("uri,u", po::value<std::string>(&uri)->default_value("amqp://localhost"), "broker uri");
-  options("cameras,c", po::value<std::vector<std::string>>(&cameras)->multitoken(), "cameras");
+  common.add_uri(description);
+  common.add_cameras(description);
   options("yaml-file,y", po::value<std::string>(&yaml_file)->default_value("configuration.yaml"), "configuration file");
+  common.add_brokers(description);
+  common.add_metrics(description);
+  options("watch,w", "samples the configurations into the history file until interrupted");
+  options("rate,r", po::value<double>(&rate)->default_value(1.0), "watch sampling rate [Hz]");
+  options("history,H", po::value<std::string>(&history_file)->default_value("configuration.history"),
+          "history file");
+  options("capacity", po::value<uint64_t>(&capacity)->default_value(86400),
+          "samples kept per camera when creating the history file");
 
   po::variables_map vm;
   po::store(po::parse_command_line(argc, argv, description), vm);
@@ -35,29 +51,49 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
-  auto is = is::connect(uri);
-  auto client = is::make_client(is);
+  if (!(rate > 0.0)) {
+    is::log::warn("--rate must be greater than 0");
+    return 1;
+  }
+
+  auto& cameras = common.cameras;
+  is::camera::CameraClient client(common.uri, common.brokers_file);
 
-  std::vector<std::string> ids;
-  for (auto& camera : cameras) {
-    ids.push_back(client.request(camera + ".get_configuration", is::msgpack(0)));
+  if (vm.count("watch")) {
+    is::camera::history::ConfigHistory history(history_file, cameras, capacity);
+    std::signal(SIGINT, [](int) { running = false; });
+    std::signal(SIGTERM, [](int) { running = false; });
+    is::log::info("Watching {} cameras at {} Hz into {}", cameras.size(), rate, history_file);
+
+    auto period = std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+        std::chrono::duration<double>(1.0 / rate));
+    auto next = std::chrono::high_resolution_clock::now();
+    while (running) {
+      auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::system_clock::now().time_since_epoch()).count();
+      auto configurations = client.get_configurations(cameras);
+      for (auto& camera : cameras) {
+        auto config = configurations.find(camera);
+        if (config == configurations.end()) {
+          is::log::warn("Sample missed for {}", camera);
+        } else if (!history.append(camera, timestamp, config->second)) {
+          is::log::warn("{} is not on {}", camera, history_file);
+        }
+      }
+      next = std::max(next + period, std::chrono::high_resolution_clock::now());
+      std::this_thread::sleep_until(next);
+    }
+    history.flush();
+    common.report();
+    return 0;
   }
 
-  auto configuration_msgs =
-      client.receive_until(std::chrono::high_resolution_clock::now() + 1s, ids, is::policy::discard_others);
+  auto configurations = client.get_configurations(cameras);
+  common.report();
 
-  if (configuration_msgs.size() != cameras.size())
+  if (configurations.size() != cameras.size())
     exit(0);
 
-  auto config_iterator_begin = boost::make_zip_iterator(boost::make_tuple(configuration_msgs.begin(), cameras.begin()));
-  auto config_iterator_end = boost::make_zip_iterator(boost::make_tuple(configuration_msgs.end(), cameras.end()));
-  std::map<std::string, Configuration> configurations;
-  std::for_each(config_iterator_begin, config_iterator_end, [&](auto config) {
-    auto configuration = is::msgpack<Configuration>(boost::get<0>(config).second);
-    auto camera = boost::get<1>(config);
-    configurations.emplace(camera, configuration);
-  });
-
   is::camera::configuration::from_configurations(configurations, yaml_file);
   
   /*
@@ -0,0 +1,169 @@
+#ifndef __JITTER_BUFFER_HPP__
+#define __JITTER_BUFFER_HPP__
+
+#include <is/is.hpp>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace is {
+namespace camera {
+
+using namespace std::chrono;
+
+struct Frame {
+  std::string topic;
+  is::Envelope::ptr_t msg;  // nullptr until the first frame of the topic arrives
+  bool stale;
+  int64_t timestamp;  // [ms] since epoch
+};
+
+struct Lateness {
+  uint64_t on_time{0};
+  uint64_t missing{0};  // sets emitted with the last frame of this camera
+  uint64_t dropped{0};  // frames of sets already emitted
+  double total_ms{0.0};
+  double max_ms{0.0};
+
+  double mean_ms() const { return on_time > 0 ? total_ms / on_time : 0.0; }
+};
+
+// Aligns the frames of several topics by capture timestamp. A set is emitted as soon as every topic has a frame
+// within 'tolerance' of the oldest pending one, or when 'max_wait' has passed since that frame arrived. Topics
+// missing at the deadline repeat their last frame, marked as stale.
+class JitterBuffer {
+  struct Pending {
+    is::Envelope::ptr_t msg;
+    int64_t timestamp;
+    steady_clock::time_point arrival;
+  };
+
+ public:
+  JitterBuffer(std::vector<std::string> const& topics, milliseconds max_wait, milliseconds tolerance,
+               std::size_t depth = 8)
+      : topics(topics), max_wait(max_wait), tolerance(tolerance.count()), depth(depth) {
+    for (auto& topic : topics) {
+      pending[topic];
+      last[topic] = Frame{topic, nullptr, true, 0};
+      lateness[topic];
+    }
+  }
+
+  // Next set of frames, one per topic in the order given. Returns an empty set when 'until' passes first.
+  std::vector<Frame> next(is::Connection& is, std::string const& tag,
+                          steady_clock::time_point until = steady_clock::time_point::max()) {
+    for (;;) {
+      auto reference = oldest();
+      auto now = steady_clock::now();
+      if (reference == nullptr && until == steady_clock::time_point::max()) {
+        push(is.consume(tag));
+        continue;
+      }
+
+      auto deadline = until;
+      if (reference != nullptr) {
+        auto complete =
+            std::all_of(topics.begin(), topics.end(), [&](auto& topic) { return matches(topic, *reference); });
+        if (complete || now >= reference->arrival + max_wait) {
+          return emit(*reference);
+        }
+        deadline = std::min(deadline, reference->arrival + max_wait);
+      }
+      if (now >= until)
+        return {};
+
+      auto msg = is.consume_for(tag, duration_cast<milliseconds>(deadline - now));
+      if (msg != nullptr)
+        push(msg);
+    }
+  }
+
+  std::map<std::string, Lateness> const& statistics() const { return lateness; }
+
+ private:
+  // Capture time set by the publisher, [ms] since epoch. Frames without one fall back to their arrival on the same
+  // wall clock, so they can still be compared with the ones that have it.
+  static int64_t timestamp_of(is::Envelope::ptr_t const& msg) {
+    auto message = msg->Message();
+    if (message->TimestampIsSet())
+      return static_cast<int64_t>(message->Timestamp());
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+  }
+
+  void push(is::Envelope::ptr_t const& msg) {
+    auto queue = pending.find(msg->RoutingKey());
+    if (queue == pending.end())
+      return;
+    auto arrival = steady_clock::now();
+    auto timestamp = timestamp_of(msg);
+    // Belongs to a set already emitted: if kept, it would start a set of its own with every other topic stale.
+    if (emitted && timestamp <= last_reference + tolerance) {
+      lateness[queue->first].dropped++;
+      return;
+    }
+    queue->second.push_back(Pending{msg, timestamp, arrival});
+    if (queue->second.size() > depth)
+      queue->second.pop_front();
+  }
+
+  Pending const* oldest() const {
+    Pending const* reference = nullptr;
+    for (auto& queue : pending) {
+      if (!queue.second.empty() && (reference == nullptr || queue.second.front().timestamp < reference->timestamp))
+        reference = &queue.second.front();
+    }
+    return reference;
+  }
+
+  bool matches(std::string const& topic, Pending const& reference) const {
+    auto& queue = pending.at(topic);
+    return !queue.empty() && queue.front().timestamp <= reference.timestamp + tolerance;
+  }
+
+  std::vector<Frame> emit(Pending reference) {
+    std::vector<Frame> frames;
+    for (auto& topic : topics) {
+      auto& stats = lateness[topic];
+      if (matches(topic, reference)) {
+        auto& head = pending[topic].front();
+        double late = std::max(0.0, duration<double, std::milli>(head.arrival - reference.arrival).count());
+        stats.on_time++;
+        stats.total_ms += late;
+        stats.max_ms = std::max(stats.max_ms, late);
+        last[topic] = Frame{topic, head.msg, false, head.timestamp};
+        pending[topic].pop_front();
+      } else {
+        stats.missing++;
+        last[topic].stale = true;
+      }
+      frames.push_back(last[topic]);
+    }
+    last_reference = reference.timestamp;
+    emitted = true;
+    for (auto& queue : pending) {
+      while (!queue.second.empty() && queue.second.front().timestamp <= last_reference + tolerance) {
+        lateness[queue.first].dropped++;
+        queue.second.pop_front();
+      }
+    }
+    return frames;
+  }
+
+  std::vector<std::string> topics;
+  milliseconds max_wait;
+  int64_t tolerance;
+  std::size_t depth;
+  std::map<std::string, std::deque<Pending>> pending;
+  std::map<std::string, Frame> last;
+  std::map<std::string, Lateness> lateness;
+  int64_t last_reference{0};
+  bool emitted{false};
+};
+
+}  // ::camera
+}  // ::is
+
+#endif  // __JITTER_BUFFER_HPP__
@@ -0,0 +1,128 @@
+#ifndef __MJPEG_SERVER_HPP__
+#define __MJPEG_SERVER_HPP__
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace is {
+namespace camera {
+
+using Jpeg = std::shared_ptr<const std::vector<unsigned char>>;
+
+// Serves the last published JPEG as a multipart/x-mixed-replace stream to any number of HTTP clients. Every client
+// holds a reference to the same buffer; a client that is still writing when new frames arrive skips straight to the
+// latest one instead of queueing copies.
+class MjpegServer {
+  struct State {
+    std::mutex mutex;
+    std::condition_variable updated;
+    Jpeg frame;
+    uint64_t sequence{0};
+    std::atomic<unsigned int> clients{0};
+  };
+
+ public:
+  MjpegServer(unsigned short port) : state(std::make_shared<State>()) {
+    listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+      throw std::runtime_error("mjpeg: socket failed");
+    int reuse = 1;
+    ::setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(listen_fd, 16) < 0) {
+      ::close(listen_fd);
+      throw std::runtime_error("mjpeg: unable to listen on port " + std::to_string(port));
+    }
+    acceptor = std::thread([fd = listen_fd, state = state]() {
+      for (;;) {
+        int client = ::accept(fd, nullptr, nullptr);
+        if (client < 0)
+          break;
+        std::thread(serve, client, state).detach();
+      }
+    });
+  }
+
+  ~MjpegServer() {
+    ::shutdown(listen_fd, SHUT_RDWR);
+    ::close(listen_fd);
+    acceptor.join();
+  }
+
+  void publish(Jpeg const& jpeg) {
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->frame = jpeg;
+      state->sequence++;
+    }
+    state->updated.notify_all();
+  }
+
+  unsigned int clients() const { return state->clients.load(); }
+
+ private:
+  static bool write_all(int fd, const void* data, std::size_t size) {
+    auto bytes = static_cast<const char*>(data);
+    while (size > 0) {
+      auto n = ::send(fd, bytes, size, MSG_NOSIGNAL);
+      if (n <= 0)
+        return false;
+      bytes += n;
+      size -= n;
+    }
+    return true;
+  }
+
+  static void serve(int fd, std::shared_ptr<State> state) {
+    state->clients++;
+    char request[1024];
+    ::recv(fd, request, sizeof(request), 0);  // any request gets the stream
+
+    const std::string header =
+        "HTTP/1.0 200 OK\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Connection: close\r\n"
+        "Content-Type: multipart/x-mixed-replace; boundary=mjpegframe\r\n\r\n";
+    bool alive = write_all(fd, header.data(), header.size());
+
+    uint64_t sent = 0;
+    while (alive) {
+      Jpeg frame;
+      {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->updated.wait(lock, [&]() { return state->sequence != sent; });
+        frame = state->frame;
+        sent = state->sequence;
+      }
+      auto part = "--mjpegframe\r\nContent-Type: image/jpeg\r\nContent-Length: " + std::to_string(frame->size()) +
+                  "\r\n\r\n";
+      alive = write_all(fd, part.data(), part.size()) && write_all(fd, frame->data(), frame->size()) &&
+              write_all(fd, "\r\n", 2);
+    }
+    ::close(fd);
+    state->clients--;
+  }
+
+  std::shared_ptr<State> state;
+  int listen_fd;
+  std::thread acceptor;
+};
+
+}  // ::camera
+}  // ::is
+
+#endif  // __MJPEG_SERVER_HPP__
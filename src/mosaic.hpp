@@ -0,0 +1,37 @@
+#ifndef __MOSAIC_HPP__
+#define __MOSAIC_HPP__
+
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+namespace is {
+namespace camera {
+
+// Places the first two frames on the upper row and the remaining ones on the lower row.
+inline cv::Mat make_mosaic(std::vector<cv::Mat> const& frames) {
+  std::vector<cv::Mat> up_frames, down_frames;
+  int n_frame = 0;
+  for (auto& frame : frames) {
+    if (n_frame < 2) {
+      up_frames.push_back(frame);
+    } else {
+      down_frames.push_back(frame);
+    }
+    n_frame++;
+  }
+
+  cv::Mat output_image;
+  cv::Mat up_row, down_row;
+  std::vector<cv::Mat> rows_frames;
+  cv::hconcat(up_frames, up_row);
+  rows_frames.push_back(up_row);
+  cv::hconcat(down_frames, down_row);
+  rows_frames.push_back(down_row);
+  cv::vconcat(rows_frames, output_image);
+  return output_image;
+}
+
+}  // ::camera
+}  // ::is
+
+#endif  // __MOSAIC_HPP__
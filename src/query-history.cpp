@@ -0,0 +1,106 @@
+#include <boost/program_options.hpp>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include "config-history.hpp"
+#include "yaml-configure.hpp"
+
+namespace po = boost::program_options;
+using namespace is::msg::camera;
+using namespace is::msg::common;
+
+template <typename T>
+std::string field(boost::optional<T> const& value) {
+  return value ? std::to_string(*value) : "";
+}
+
+void to_csv(std::ostream& out, std::string const& camera, int64_t timestamp, Configuration const& config) {
+  auto mode = [](boost::optional<bool> const& auto_mode) {
+    return auto_mode ? (*auto_mode ? "auto" : "manual") : "";
+  };
+  out << camera << "," << timestamp << ",";
+  out << (config.sampling_rate ? field((*(config.sampling_rate)).rate) : "") << ",";
+  out << (config.image_type ? (*(config.image_type)).value : "") << ",";
+  out << (config.resolution ? std::to_string((*(config.resolution)).width) : "") << ",";
+  out << (config.resolution ? std::to_string((*(config.resolution)).height) : "") << ",";
+  out << field(config.brightness) << ",";
+  out << (config.exposure ? mode((*(config.exposure)).auto_mode) : "") << ",";
+  out << (config.exposure ? std::to_string((*(config.exposure)).value) : "") << ",";
+  out << (config.shutter ? mode((*(config.shutter)).auto_mode) : "") << ",";
+  out << (config.shutter ? field((*(config.shutter)).percent) : "") << ",";
+  out << (config.shutter ? field((*(config.shutter)).ms) : "") << ",";
+  out << (config.gain ? mode((*(config.gain)).auto_mode) : "") << ",";
+  out << (config.gain ? field((*(config.gain)).percent) : "") << ",";
+  out << (config.gain ? field((*(config.gain)).db) : "") << ",";
+  out << (config.white_balance ? mode((*(config.white_balance)).auto_mode) : "") << ",";
+  out << (config.white_balance ? field((*(config.white_balance)).red) : "") << ",";
+  out << (config.white_balance ? field((*(config.white_balance)).blue) : "") << "\n";
+}
+
+int main(int argc, char* argv[]) {
+  std::string history_file;
+  std::vector<std::string> cameras;
+  int64_t from, to;
+  std::string format;
+  std::string output;
+
+  po::options_description description("Allowed options");
+  auto&& options = description.add_options();
+  options("help,", "show available options");
+  options("history,H", po::value<std::string>(&history_file)->default_value("configuration.history"),
+          "history file");
+  options("cameras,c", po::value<std::vector<std::string>>(&cameras)->multitoken(), "cameras (default: all)");
+  options("from,f", po::value<int64_t>(&from)->default_value(0), "first timestamp [ms since epoch]");
+  options("to,t", po::value<int64_t>(&to)->default_value(std::numeric_limits<int64_t>::max()),
+          "last timestamp [ms since epoch]");
+  options("format", po::value<std::string>(&format)->default_value("yaml"), "output format [yaml|csv]");
+  options("output,o", po::value<std::string>(&output), "output file (default: stdout)");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, description), vm);
+  po::notify(vm);
+
+  if (vm.count("help") || (format != "yaml" && format != "csv")) {
+    std::cout << description << std::endl;
+    return 1;
+  }
+
+  is::camera::history::ConfigHistory history(history_file);
+  if (!vm.count("cameras")) {
+    cameras = history.cameras();
+  }
+
+  std::ofstream file;
+  if (vm.count("output")) {
+    file.open(output);
+  }
+  std::ostream& out = vm.count("output") ? file : std::cout;
+
+  if (format == "csv") {
+    out << "camera,timestamp,fps,type,width,height,brightness,exposure_mode,exposure,shutter_mode,shutter_percent,"
+           "shutter_ms,gain_mode,gain_percent,gain_db,wb_mode,wb_red,wb_blue\n";
+    for (auto& camera : cameras) {
+      for (auto& sample : history.query(camera, from, to)) {
+        to_csv(out, camera, sample.first, sample.second);
+      }
+    }
+    return 0;
+  }
+
+  YAML::Emitter emitter;
+  emitter << YAML::BeginSeq;
+  for (auto& camera : cameras) {
+    for (auto& sample : history.query(camera, from, to)) {
+      emitter << YAML::BeginMap;
+      emitter << YAML::Key << "name" << YAML::Value << camera;
+      emitter << YAML::Key << "timestamp" << YAML::Value << sample.first;
+      is::camera::configuration::emit_configuration(emitter, sample.second);
+      emitter << YAML::EndMap;
+    }
+  }
+  emitter << YAML::EndSeq;
+  out << emitter.c_str() << std::endl;
+  return 0;
+}
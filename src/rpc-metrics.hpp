@@ -0,0 +1,177 @@
+#ifndef __RPC_METRICS_HPP__
+#define __RPC_METRICS_HPP__
+
+#include <is/is.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace is {
+namespace camera {
+
+using namespace std::chrono;
+
+// Round trip times in seconds, with prometheus-like cumulative buckets.
+struct Histogram {
+  static std::vector<double> const& bounds() {
+    static const std::vector<double> bounds{0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0};
+    return bounds;
+  }
+
+  std::vector<uint64_t> counts = std::vector<uint64_t>(bounds().size() + 1, 0);
+  uint64_t count{0};
+  double sum{0.0};
+  double max{0.0};
+  uint64_t timeouts{0};
+  uint64_t retries{0};
+
+  void observe(double seconds) {
+    auto bucket = std::lower_bound(bounds().begin(), bounds().end(), seconds) - bounds().begin();
+    counts[bucket]++;
+    count++;
+    sum += seconds;
+    max = std::max(max, seconds);
+  }
+
+  // upper bound of the bucket holding the q-th quantile
+  double quantile(double q) const {
+    uint64_t rank = static_cast<uint64_t>(q * count), seen = 0;
+    for (std::size_t i = 0; i < bounds().size(); ++i) {
+      seen += counts[i];
+      if (seen > rank)
+        return bounds()[i];
+    }
+    return max;
+  }
+};
+
+// Records round trip times, timeouts and retries of every request made through it, per method and camera.
+// Thread safe, so shards running in parallel can share it.
+class RpcMetrics {
+  struct InFlight {
+    std::string method;
+    std::string camera;
+    high_resolution_clock::time_point start;
+  };
+
+ public:
+  std::string request(is::ServiceClient& client, std::string const& camera, std::string const& method,
+                      is::Message::ptr_t const& msg) {
+    auto start = high_resolution_clock::now();
+    auto id = client.request(camera + "." + method, msg);
+    std::lock_guard<std::mutex> lock(mutex);
+    in_flight[id] = InFlight{method, camera, start};
+    return id;
+  }
+
+  // Any reply, matched back to its request by correlation id.
+  is::Envelope::ptr_t receive_for(is::ServiceClient& client, high_resolution_clock::duration timeout) {
+    auto msg = client.receive_for(duration_cast<milliseconds>(timeout));
+    if (msg != nullptr)
+      done(msg->Message()->CorrelationId(), true);
+    return msg;
+  }
+
+  // Counts a request still without reply as timed out.
+  void expire(std::string const& id) { done(id, false); }
+
+  void retry(std::string const& camera, std::string const& method) {
+    std::lock_guard<std::mutex> lock(mutex);
+    histograms[std::make_pair(method, camera)].retries++;
+  }
+
+  void write_prometheus(std::string const& filename) const {
+    // Written aside and renamed over the target, so a reader (e.g. the node exporter textfile collector) never sees
+    // it half written.
+    auto temporary = filename + ".tmp";
+    std::lock_guard<std::mutex> lock(mutex);
+    {
+      std::ofstream file(temporary);
+      file << "# HELP is_camera_rpc_duration_seconds Round trip time of camera requests.\n";
+      file << "# TYPE is_camera_rpc_duration_seconds histogram\n";
+      for (auto& entry : histograms) {
+        auto labels = "method=\"" + entry.first.first + "\",camera=\"" + entry.first.second + "\"";
+        auto& histogram = entry.second;
+        uint64_t cumulative = 0;
+        for (std::size_t i = 0; i < Histogram::bounds().size(); ++i) {
+          cumulative += histogram.counts[i];
+          file << "is_camera_rpc_duration_seconds_bucket{" << labels << ",le=\"" << Histogram::bounds()[i] << "\"} "
+               << cumulative << "\n";
+        }
+        file << "is_camera_rpc_duration_seconds_bucket{" << labels << ",le=\"+Inf\"} " << histogram.count << "\n";
+        file << "is_camera_rpc_duration_seconds_sum{" << labels << "} " << histogram.sum << "\n";
+        file << "is_camera_rpc_duration_seconds_count{" << labels << "} " << histogram.count << "\n";
+      }
+      file << "# HELP is_camera_rpc_timeouts_total Camera requests without reply until their deadline.\n";
+      file << "# TYPE is_camera_rpc_timeouts_total counter\n";
+      for (auto& entry : histograms) {
+        file << "is_camera_rpc_timeouts_total{method=\"" << entry.first.first << "\",camera=\"" << entry.first.second
+             << "\"} " << entry.second.timeouts << "\n";
+      }
+      file << "# HELP is_camera_rpc_retries_total Camera requests sent again after a failure.\n";
+      file << "# TYPE is_camera_rpc_retries_total counter\n";
+      for (auto& entry : histograms) {
+        file << "is_camera_rpc_retries_total{method=\"" << entry.first.first << "\",camera=\"" << entry.first.second
+             << "\"} " << entry.second.retries << "\n";
+      }
+      file.close();
+      if (!file) {
+        is::log::warn("Failed to write metrics to {}", temporary);
+        return;
+      }
+    }
+    if (std::rename(temporary.c_str(), filename.c_str()) != 0)
+      is::log::warn("Failed to replace {}: {}", filename, std::strerror(errno));
+  }
+
+  void summary() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& entry : histograms) {
+      auto& h = entry.second;
+      is::log::info("[{}|{}] requests: {}, timeouts: {}, retries: {}, mean: {:.1f}ms, p50: <{}ms, p99: <{}ms, "
+                    "max: {:.1f}ms",
+                    entry.first.second, entry.first.first, h.count + h.timeouts, h.timeouts, h.retries,
+                    h.count > 0 ? 1000.0 * h.sum / h.count : 0.0, 1000.0 * h.quantile(0.5),
+                    1000.0 * h.quantile(0.99), 1000.0 * h.max);
+    }
+  }
+
+ private:
+  void done(std::string const& id, bool replied) {
+    auto now = high_resolution_clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto request = in_flight.find(id);
+    if (request == in_flight.end())
+      return;
+    auto& histogram = histograms[std::make_pair(request->second.method, request->second.camera)];
+    if (replied) {
+      histogram.observe(duration<double>(now - request->second.start).count());
+    } else {
+      histogram.timeouts++;
+    }
+    in_flight.erase(request);
+  }
+
+  mutable std::mutex mutex;
+  std::unordered_map<std::string, InFlight> in_flight;
+  std::map<std::pair<std::string, std::string>, Histogram> histograms;
+};
+
+inline RpcMetrics& rpc_metrics() {
+  static RpcMetrics metrics;
+  return metrics;
+}
+
+}  // ::camera
+}  // ::is
+
+#endif  // __RPC_METRICS_HPP__
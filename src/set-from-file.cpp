@@ -1,25 +1,172 @@
+#include <algorithm>
 #include <boost/program_options.hpp>
 #include <is/is.hpp>
 #include <is/msgs/camera.hpp>
 #include <is/msgs/common.hpp>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <chrono>
+#include "camera-client.hpp"
+#include "client-options.hpp"
+#include "jitter-buffer.hpp"
 #include "yaml-configure.hpp"
 
 namespace po = boost::program_options;
 using namespace is::msg::camera;
 using namespace is::msg::common;
+using namespace std::chrono;
+
+// Applies all configurations between two synchronized frame sets, so that every camera switches on the same frame.
+// Cameras can't hold a configuration to apply later, so staging means taking a snapshot of every current
+// configuration (to roll back to), and the trigger is sending all requests right after the chosen set arrives.
+// Returns 0 when every camera switched, 1 when none was changed or all were rolled back, 2 when the rollback failed.
+int sync_apply(std::string const& uri, std::map<std::string, Configuration> const& configurations,
+               unsigned int at_frame, int64_t at_timestamp) {
+  is::camera::CameraClient client(uri);
+
+  std::vector<std::string> cameras;
+  for (auto& config : configurations) {
+    cameras.push_back(config.first);
+  }
+  auto snapshots = client.get_configurations(cameras, 2s);
+  double rate = 0.0;
+  for (auto& camera : cameras) {
+    auto snapshot = snapshots.find(camera);
+    if (snapshot == snapshots.end()) {
+      is::log::warn("Failed to stage {}", camera);
+      continue;
+    }
+    auto& sampling_rate = snapshot->second.sampling_rate;
+    if (sampling_rate && (*sampling_rate).rate)
+      rate = std::max(rate, *((*sampling_rate).rate));
+  }
+  if (snapshots.size() != cameras.size()) {
+    is::log::warn("Staging failed, no camera was changed");
+    return 1;
+  }
+  is::log::info("Staged {} cameras", cameras.size());
+
+  auto is = is::connect(uri);
+  std::vector<std::string> topics;
+  for (auto& camera : cameras) {
+    topics.push_back(camera + ".frame");
+  }
+  auto tag = is.subscribe(topics);
+  auto period = milliseconds(static_cast<int64_t>(1000.0 / (rate > 0.0 ? rate : 5.0)));
+  is::camera::JitterBuffer jitter_buffer(topics, period, period / 2);
+
+  // No set for this long means the cameras are not streaming.
+  auto patience = 2s + 10 * period;
+  uint64_t trigger_set = 0;
+  for (;;) {
+    auto frames = jitter_buffer.next(is, tag, steady_clock::now() + patience);
+    if (frames.empty()) {
+      is::log::warn("No frames from the cameras, no camera was changed");
+      return 1;
+    }
+    ++trigger_set;
+    auto timestamp = std::max_element(frames.begin(), frames.end(), [](auto& lhs, auto& rhs) {
+                       return lhs.timestamp < rhs.timestamp;
+                     })->timestamp;
+    if (at_timestamp > 0 ? timestamp >= at_timestamp : trigger_set >= at_frame)
+      break;
+  }
+
+  // Follows the synchronized sets while the replies arrive. A camera switches on the first set holding a frame of it
+  // captured after its reply, which is an estimate: the camera may apply the change a little before replying.
+  std::mutex mutex;
+  std::map<std::string, int64_t> replied_at;
+  std::vector<std::string> failed;
+  for (auto& config : configurations) {
+    auto camera = config.first;
+    auto replied = [&, camera](is::camera::Result const& result) {
+      auto error = is::camera::error_of(result);
+      auto now = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+      std::lock_guard<std::mutex> lock(mutex);
+      if (error.empty()) {
+        replied_at.emplace(camera, now);
+      } else {
+        is::log::warn("{} failed to switch: {}", camera, error);
+        failed.push_back(camera);
+      }
+    };
+    client.request(camera, "set_configuration", is::msgpack(config.second), replied, 2s);
+  }
+  is::log::info("Switching after set {}", trigger_set);
+
+  std::map<std::string, uint64_t> switched_at;
+  auto current_set = trigger_set;
+  auto deadline = steady_clock::now() + patience;
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (switched_at.size() + failed.size() == cameras.size())
+        break;
+    }
+    if (steady_clock::now() >= deadline) {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto& camera : cameras) {
+        if (!switched_at.count(camera) && std::find(failed.begin(), failed.end(), camera) == failed.end()) {
+          is::log::warn("{} sent no frame after switching", camera);
+          failed.push_back(camera);
+        }
+      }
+      break;
+    }
+
+    auto frames = jitter_buffer.next(is, tag, deadline);
+    if (frames.empty())
+      continue;
+    ++current_set;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::size_t i = 0; i < cameras.size(); ++i) {
+      auto replied = replied_at.find(cameras[i]);
+      if (replied == replied_at.end() || switched_at.count(cameras[i]))
+        continue;
+      if (!frames[i].stale && frames[i].timestamp >= replied->second)
+        switched_at.emplace(cameras[i], current_set);
+    }
+  }
+  client.wait();
+
+  if (!failed.empty()) {
+    is::log::warn("Rolling back {} cameras", cameras.size());
+    auto errors = client.set_configurations(snapshots, "set_configuration", 2s);
+    for (auto& error : errors) {
+      is::log::warn("{} failed to roll back: {}", error.first, error.second);
+    }
+    if (!errors.empty()) {
+      is::log::warn("Partial rollback, {} of {} cameras may be left with the new configuration", errors.size(),
+                    cameras.size());
+      return 2;
+    }
+    return 1;
+  }
+
+  for (auto& camera : switched_at) {
+    is::log::info("{} switched on set {} (first set after its reply)", camera.first, camera.second);
+  }
+  return 0;
+}
 
 int main(int argc, char* argv[]) {
-  std::string uri;
+  is::camera::ClientOptions common;
   std::string yaml_file;
+  unsigned int at_frame;
+  int64_t at_timestamp;
  
   po::options_description description("Allowed options");
   auto&& options = description.add_options();
   options("help,", "show available options");
-  options("uri,u", po::value<std::string>(&uri)->default_value("amqp://localhost"), "broker uri");
+  common.add_uri(description);
   options("yaml-file,y", po::value<std::string>(&yaml_file), "configuration file");
+  common.add_brokers(description);
+  common.add_metrics(description);
+  options("sync", "switches all cameras on the same frame, rolling back if any of them fails");
+  options("at-frame", po::value<unsigned int>(&at_frame)->default_value(3), "synchronized set to switch on");
+  options("at-timestamp", po::value<int64_t>(&at_timestamp)->default_value(0),
+          "switches on the first set captured at or after this timestamp [ms since epoch], overrides --at-frame");
 
   po::variables_map vm;
   po::store(po::parse_command_line(argc, argv, description), vm);
@@ -32,15 +179,24 @@ int main(int argc, char* argv[]) {
 
   auto configurations = is::camera::configuration::from_file(yaml_file);
 
-  auto is = is::connect(uri);
-  auto client = is::make_client(is);
+  if (vm.count("sync")) {
+    // frames are followed on a single broker
+    if (vm.count("brokers")) {
+      is::log::warn("--sync can't be used with --brokers, all cameras must be on {}", common.uri);
+      return 1;
+    }
+    auto code = sync_apply(common.uri, configurations, at_frame, at_timestamp);
+    common.report();
+    return code;
+  }
 
-  std::vector<std::string> ids;
+  is::camera::CameraClient client(common.uri, common.brokers_file);
   for (auto& config : configurations) {
     is::log::info("Configuring {}", config.first);
-    ids.push_back(client.request(config.first + ".set_configuration", is::msgpack(config.second)));
   }
-
-  client.receive_until(std::chrono::high_resolution_clock::now() + 1s, ids, is::policy::discard_others);
+  for (auto& error : client.set_configurations(configurations)) {
+    is::log::warn("{} failed: {}", error.first, error.second);
+  }
+  common.report();
   return 0;
 }
\ No newline at end of file
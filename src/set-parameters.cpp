@@ -1,4 +1,5 @@
 #include <boost/program_options.hpp>
+#include <fstream>
 #include <iostream>
 #include <is/is.hpp>
 #include <is/msgs/camera.hpp>
@@ -8,25 +9,38 @@
 #include <opencv2/imgproc.hpp>
 #include <string>
 #include <vector>
+#include "batch-apply.hpp"
+#include "camera-client.hpp"
+#include "client-options.hpp"
+#include "properties.hpp"
 
 namespace po = boost::program_options;
 using namespace is::msg::camera;
 using namespace is::msg::common;
 
 int main(int argc, char* argv[]) {
-  std::string uri;
-  std::vector<std::string> cameras;
+  is::camera::ClientOptions common;
   float brightness_f;
   float exposure_f;
   float shutter_f;
   float gain_f;
   std::vector<unsigned int> wb;
+  std::string batch_file;
+  std::size_t max_in_flight;
+  unsigned int timeout_ms;
 
   po::options_description description("Allowed options");
   auto&& options = description.add_options();
   options("help,", "show available options");
-  options("uri,u", po::value<std::string>(&uri)->default_value("amqp://localhost"), "broker uri");
-  options("cameras,c", po::value<std::vector<std::string>>(&cameras)->multitoken(), "cameras");
+  common.add_uri(description);
+  common.add_cameras(description);
+  common.add_brokers(description, "brokers");
+  common.add_metrics(description);
+  options("batch", po::value<std::string>(&batch_file),
+          "applies the updates on a file ('-' for stdin), one JSON object per line, reporting each result on stdout");
+  options("max-in-flight", po::value<std::size_t>(&max_in_flight)->default_value(256),
+          "maximum requests pending per broker on batch mode");
+  options("timeout", po::value<unsigned int>(&timeout_ms)->default_value(1000), "request timeout on batch mode [ms]");
 
   options("brightness,b", po::value<float>(&brightness_f), "brightness [1.367~7.422] (1.367)");
   options("exposure,e", po::value<float>(&exposure_f), "exposure [-7.585~2.414] (0.858)");
@@ -43,11 +57,53 @@ int main(int argc, char* argv[]) {
   po::store(po::parse_command_line(argc, argv, description), vm);
   po::notify(vm);
 
-  if (vm.count("help") || !vm.count("cameras")) {
+  if (vm.count("help") || (!vm.count("cameras") && !vm.count("batch"))) {
     std::cout << description << std::endl;
     return 1;
   }
-  
+
+  if (max_in_flight < 1) {
+    is::log::warn("--max-in-flight must be at least 1");
+    return 1;
+  }
+
+  if (vm.count("batch")) {
+    std::ifstream file;
+    if (batch_file != "-")
+      file.open(batch_file);
+    std::istream& in = batch_file != "-" ? file : std::cin;
+    if (!in) {
+      is::log::warn("Unable to open {}", batch_file);
+      return 1;
+    }
+    auto failed = is::camera::batch::apply(in, std::cout, common.uri, common.brokers_file, max_in_flight,
+                                           std::chrono::milliseconds(timeout_ms));
+    common.report();
+    return failed > 0 ? 1 : 0;
+  }
+
+  try {
+    if (vm.count("brightness"))
+      check_range("Brightness", brightness_f);
+    if (vm.count("exposure"))
+      check_range("Exposure", exposure_f);
+    if (vm.count("shutter"))
+      check_range("Shutter", shutter_f);
+    if (vm.count("gain"))
+      check_range("Gain", gain_f);
+    if (vm.count("white-balance")) {
+      if (wb.size() != 2) {
+        is::log::warn("--white-balance expects two values, <red> <blue>");
+        return 1;
+      }
+      check_range("WB[red]", wb[0]);
+      check_range("WB[blue]", wb[1]);
+    }
+  } catch (std::out_of_range& e) {
+    is::log::warn("{}", e.what());
+    return 1;
+  }
+
   Configuration configuration;
 
   if (vm.count("brightness")) {
@@ -90,12 +146,10 @@ int main(int argc, char* argv[]) {
     is::log::info("WhiteBalance: {}", white_balance.auto_mode.get() ? "auto" : (std::to_string(white_balance.red.get()) + "/" + std::to_string(white_balance.blue.get())));
   }
 
-  auto is = is::connect(uri);
-  auto client = is::make_client(is);
-
-  for (auto& camera : cameras) {
-    client.request(camera + ".configure", is::msgpack(configuration));
+  is::camera::CameraClient client(common.uri, common.brokers_file);
+  for (auto& error : client.set_configuration(common.cameras, configuration, "configure")) {
+    is::log::warn("{} failed: {}", error.first, error.second);
   }
-  client.receive_for(1s);
+  common.report();
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef __SHARDS_HPP__
+#define __SHARDS_HPP__
+
+#include <yaml-cpp/yaml.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace is {
+namespace camera {
+namespace shards {
+
+struct Rule {
+  std::string uri;
+  std::vector<std::string> cameras;
+  std::string prefix;
+};
+
+// Brokers file, one entry per broker, cameras matched by name or by the longest prefix:
+// - uri: amqp://10.0.0.1
+//   cameras: [ptgrey.0, ptgrey.1]
+// - uri: amqp://10.0.0.2
+//   prefix: ptgrey.b.
+inline std::vector<Rule> load_rules(std::string const& filename) {
+  YAML::Node yaml = YAML::LoadFile(filename);
+  std::vector<Rule> rules;
+  for (auto&& broker : yaml) {
+    Rule rule;
+    rule.uri = broker["uri"].as<std::string>();
+    if (broker["cameras"]) {
+      rule.cameras = broker["cameras"].as<std::vector<std::string>>();
+    }
+    if (broker["prefix"]) {
+      rule.prefix = broker["prefix"].as<std::string>();
+    }
+    rules.push_back(rule);
+  }
+  return rules;
+}
+
+inline std::string broker_of(std::string const& camera, std::vector<Rule> const& rules,
+                             std::string const& default_uri) {
+  for (auto& rule : rules) {
+    if (std::find(rule.cameras.begin(), rule.cameras.end(), camera) != rule.cameras.end())
+      return rule.uri;
+  }
+  std::string uri = default_uri;
+  std::size_t longest = 0;
+  for (auto& rule : rules) {
+    auto matches = camera.compare(0, rule.prefix.size(), rule.prefix) == 0;
+    if (!rule.prefix.empty() && rule.prefix.size() > longest && matches) {
+      uri = rule.uri;
+      longest = rule.prefix.size();
+    }
+  }
+  return uri;
+}
+
+}  // ::shards
+}  // ::camera
+}  // ::is
+
+#endif  // __SHARDS_HPP__
@@ -14,10 +14,12 @@
 #include <nana/gui/widgets/checkbox.hpp>
 #include <nana/gui/widgets/combox.hpp>
 #include <nana/gui/widgets/label.hpp>
+#include <nana/gui/widgets/listbox.hpp>
 #include <nana/gui/widgets/slider.hpp>
 #include <string>
 #include <thread>
 #include <vector>
+#include "client-options.hpp"
 #include "yaml-configure.hpp"
 
 using namespace std;
@@ -33,19 +35,21 @@ const unsigned int X0 = 50;
 const unsigned int Y0 = 50;
 const unsigned int slider_vspacing = 10;
 const unsigned int slider_hspacing = 10;
+const unsigned int group_height = 120;
 
 int main(int argc, char* argv[]) {
-  std::string uri;
-  std::vector<std::string> cameras;
+  is::camera::ClientOptions common;
   const std::vector<std::string> default_cameras{"ptgrey.0", "ptgrey.1", "ptgrey.2", "ptgrey.3"};
   std::string yaml_file;
 
   po::options_description description("Allowed options");
   auto&& options = description.add_options();
   options("help,", "show available options");
-  options("uri,u", po::value<string>(&uri)->default_value("amqp://edge.is:30000"), "broker uri");
-  options("cameras,c", po::value<vector<string>>(&cameras)->multitoken()->default_value(default_cameras), "cameras");
+  common.add_uri(description, "amqp://edge.is:30000");
+  common.add_cameras(description, default_cameras);
   options("yaml-file,y", po::value<std::string>(&yaml_file)->default_value("configuration.yaml"), "configuration file");
+  common.add_brokers(description);
+  common.add_metrics(description, "writes request metrics every second (prometheus text format)");
 
   po::variables_map vm;
   po::store(po::parse_command_line(argc, argv, description), vm);
@@ -57,40 +61,30 @@ int main(int argc, char* argv[]) {
   }
 
   // Get initial parameters
-  auto is = is::connect(uri);
-  auto client = is::make_client(is);
+  auto& cameras = common.cameras;
+  is::camera::CameraClient client(common.uri, common.brokers_file);
 
-  std::vector<std::string> ids;
-  for (auto& camera : cameras) {
-    ids.push_back(client.request(camera + ".get_configuration", is::msgpack(0)));
-  }
-
-  std::unordered_map<std::string, is::Envelope::ptr_t> configuration_msgs;
+  std::map<std::string, Configuration> configurations;
   for (int i = 0; i < 5; ++i) {
     is::log::info("Requesting cameras configuration... {}/5", i + 1);
-    configuration_msgs = client.receive_until(high_resolution_clock::now() + 2s, ids, is::policy::discard_others);
-    if (configuration_msgs.size() == cameras.size())
+    configurations = client.get_configurations(cameras, 2s);
+    if (configurations.size() == cameras.size())
       break;
     if (i == 4) {
       is::log::warn("Failed. Exiting...");
       exit(0);
     } else {
       is::log::warn("Failed.");
+      for (auto& camera : cameras) {
+        if (!configurations.count(camera))
+          is::camera::rpc_metrics().retry(camera, "get_configuration");
+      }
     }
   }
 
-  std::map<std::string, Configuration> configurations;
-
-  auto config_iterator_begin = boost::make_zip_iterator(boost::make_tuple(configuration_msgs.begin(), cameras.begin()));
-  auto config_iterator_end = boost::make_zip_iterator(boost::make_tuple(configuration_msgs.end(), cameras.end()));
-  std::for_each(config_iterator_begin, config_iterator_end, [&](auto config) {
-    auto configuration = is::msgpack<Configuration>(config.get<0>().second);
-    auto camera = config.get<1>();
-    configurations.emplace(camera, configuration);
-  });
-
   auto n_properties = properties.size();
-  form fm(rectangle(0, 0, 2 * slider_width, 1.6 * (slider_height + slider_vspacing) * n_properties));
+  form fm(rectangle(0, 0, 2 * slider_width,
+                    2 * Y0 + (slider_height + slider_vspacing) * (n_properties + 3) + group_height));
   fm.caption("is::CameraParameters");
 
   unsigned int x = X0;
@@ -128,6 +122,40 @@ int main(int argc, char* argv[]) {
     is::log::info("Selected camera {}", cameras.at(cameras_list.option()));
   });
 
+  // Cameras checked on the group list get every change made to the selected one.
+  listbox group_list(fm, rectangle(X0, Y0 + (slider_height + slider_vspacing) * (n_properties + 2),
+                                   slider_width + inc_x + slider_hspacing, group_height));
+  group_list.checkable(true);
+  group_list.append_header("Group", slider_width);
+  for (auto& camera : cameras) {
+    group_list.at(0).append(camera);
+  }
+  auto status_y = Y0 + (slider_height + slider_vspacing) * (n_properties + 2) + group_height + slider_vspacing;
+  label status_label(fm, rectangle(X0, status_y, 2 * slider_width, slider_height));
+
+  auto group = [&]() {
+    std::vector<std::string> selected{cameras.at(camera.load())};
+    for (auto& index : group_list.checked()) {
+      if (cameras.at(index.item) != selected.front())
+        selected.push_back(cameras.at(index.item));
+    }
+    return selected;
+  };
+
+  auto apply = [&](std::string const& change, Configuration const& configuration) {
+    auto selected = group();
+    is::log::info("[{}{}|{}]", selected.front(),
+                  selected.size() > 1 ? "+" + std::to_string(selected.size() - 1) : std::string(), change);
+    auto errors = client.set_configuration(selected, configuration);
+    std::string failures;
+    for (auto& error : errors) {
+      is::log::warn("{} failed: {}", error.first, error.second);
+      failures += (failures.empty() ? "" : ", ") + error.first + ": " + error.second;
+    }
+    status_label.caption(failures.empty() ? "Applied to " + std::to_string(selected.size()) + " camera(s)"
+                                          : "Failed on " + failures);
+  };
+
   y += (slider_height + slider_vspacing);
   for (auto& p : properties) {
     auto property = p.first;
@@ -138,9 +166,8 @@ int main(int argc, char* argv[]) {
       if (has_mode.at(property) && cboxes.at(property)->checked()) {
         cboxes.at(property)->check(false);
       }
-      is::log::info("[{}|{}|manual|{}]", cameras.at(camera.load()), property, sl->value());
-      request_configuration(client, cameras.at(camera.load()),
-                            value_to_property.at(property)(sl->value(), 1000, false));
+      apply(property + "|manual|" + std::to_string(sl->value()),
+            value_to_property.at(property)(sl->value(), 1000, false));
     });
     sl->vernier([&](unsigned int maximum, unsigned int cursor_value) {
       auto percentage = static_cast<double>(cursor_value) / static_cast<double>(maximum);
@@ -153,25 +180,24 @@ int main(int argc, char* argv[]) {
       std::shared_ptr<checkbox> cb = std::make_shared<checkbox>(fm, rec);
       cb->events().mouse_up([&, cb, property]() {
         auto mode = cb->checked();
-        if (property == "WB[red]") {
-          cboxes.at("WB[blue]")->check(mode);
-          if (!mode) {
-            auto blue_value = sliders.at("WB[blue]")->value();
-            request_configuration(client, cameras.at(camera.load()),
-                                  value_to_property.at("WB[blue]")(blue_value, 1000, mode));
-          }
-        }
-        if (property == "WB[blue]") {
-          cboxes.at("WB[red]")->check(mode);
+        auto value = sliders.at(property)->value();
+        auto configuration = value_to_property.at(property)(value, 1000, mode);
+        // both white balance channels share the mode, so they go together on a single request
+        if (property == "WB[red]" || property == "WB[blue]") {
+          auto other = property == "WB[red]" ? "WB[blue]" : "WB[red]";
+          cboxes.at(other)->check(mode);
           if (!mode) {
-            auto red_value = sliders.at("WB[red]")->value();
-            request_configuration(client, cameras.at(camera.load()),
-                                  value_to_property.at("WB[red]")(red_value, 1000, mode));
+            auto other_value = sliders.at(other)->value();
+            auto white_balance = *(value_to_property.at(other)(other_value, 1000, mode).white_balance);
+            auto merged = *(configuration.white_balance);
+            if (white_balance.red)
+              merged.red = white_balance.red;
+            if (white_balance.blue)
+              merged.blue = white_balance.blue;
+            configuration.white_balance = merged;
           }
         }
-        is::log::info("[{}|{}|{}]", cameras.at(camera.load()), property, mode ? "auto" : "manual");
-        auto value = sliders.at(property)->value();
-        request_configuration(client, cameras.at(camera.load()), value_to_property.at(property)(value, 1000, mode));
+        apply(property + "|" + (mode ? "auto" : "manual"), configuration);
       });
       cboxes.emplace(property, cb);
     }
@@ -183,31 +209,14 @@ int main(int argc, char* argv[]) {
   button save_bt(fm, rectangle(X0, y, slider_width / 2, slider_height));
   save_bt.caption("Save");
   save_bt.events().mouse_up([&]() {
-    std::vector<std::string> ids;
-    std::vector<std::pair<std::string, std::string>> ids_cameras;
-    for (auto& camera : cameras) {
-      ids.push_back(client.request(camera + ".get_configuration", is::msgpack(0)));
-      ids_cameras.push_back(std::make_pair(ids.back(), camera));
-    }
-    auto configuration_msgs = client.receive_until(high_resolution_clock::now() + 2s, ids, is::policy::discard_others);
-    if (configuration_msgs.size() != cameras.size()) {
+    auto configurations = client.get_configurations(cameras, 2s);
+    if (configurations.size() != cameras.size()) {
       is::log::warn("Failed on requesting cameras parameters. Try again.");
       return;
     }
-    // huehue eu sou um mapa aew!
-    std::map<std::string, Configuration> configurations;
-    std::for_each(ids_cameras.begin(), ids_cameras.end(), [&](auto id_camera) {
-      auto id = id_camera.first;
-      auto camera = id_camera.second;
-      try {
-        auto msg = configuration_msgs.at(id);
-        auto configuration = is::msgpack<Configuration>(msg);
-        is::log::info("Writing {} configuration", camera);
-        configurations.emplace(camera, configuration);
-      } catch (std::out_of_range&) {
-        is::log::warn("Reply not receive from {}", camera);
-      }
-    });
+    for (auto& camera : cameras) {
+      is::log::info("Writing {} configuration", camera);
+    }
 
     if (!configurations.empty()) {
       is::log::info("Saving parameters on {}", yaml_file);
@@ -219,12 +228,11 @@ int main(int argc, char* argv[]) {
 
   std::atomic_bool running{true};
   std::thread refresh_values([&]() {
-    auto is = is::connect(uri);
-    auto client = is::make_client(is);
     while (running) {
       auto start = std::chrono::high_resolution_clock::now();
       update_values(client, cameras.at(camera.load()), sliders, cboxes, !update_all.load());
       update_all.store(false);
+      common.write_metrics();
       std::this_thread::sleep_until(start + 1s);
     }
   });
@@ -232,4 +240,6 @@ int main(int argc, char* argv[]) {
   fm.events().destroy([&running]() { running = false; });
   exec();
   refresh_values.join();
+
+  common.report();
 }
\ No newline at end of file
@@ -0,0 +1,117 @@
+#ifndef __TILES_HPP__
+#define __TILES_HPP__
+
+#include <is/is.hpp>
+#include <is/msgs/camera.hpp>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui.hpp>
+#include <opencv2/imgproc.hpp>
+#include <vector>
+#include "jitter-buffer.hpp"
+
+namespace is {
+namespace camera {
+
+using namespace is::msg::camera;
+
+struct DecodePolicy {
+  unsigned int background_every;  // background tiles are decoded on every n-th set
+  int focused_reduction;          // 1, 2, 4 or 8
+  int background_reduction;       // 1, 2, 4 or 8
+};
+
+// Keeps the latest compressed frame of every tile and decodes only what is on screen: the focused tile (or every
+// tile, when none is focused) on every set, the others on every n-th set at a lower scale, and nothing while hidden.
+// A tile whose newest payload was not decoded yet is refreshed as soon as it is focused or shown again.
+class Tiles {
+  struct Tile {
+    is::Envelope::ptr_t latest;
+    bool dirty{false};
+    bool stale{true};
+    cv::Mat image;
+  };
+
+ public:
+  Tiles(std::size_t n_tiles, cv::Size tile_size, DecodePolicy policy)
+      : tiles(n_tiles), tile_size(tile_size), policy(policy) {}
+
+  void update(std::vector<Frame> const& frames) {
+    for (std::size_t i = 0; i < frames.size() && i < tiles.size(); ++i) {
+      auto& tile = tiles[i];
+      if (frames[i].msg != tile.latest) {
+        tile.latest = frames[i].msg;
+        tile.dirty = true;
+      }
+      tile.stale = frames[i].stale;
+    }
+    n_set++;
+  }
+
+  // -1 removes the focus
+  void focus(int index) { focused = index >= 0 && static_cast<std::size_t>(index) < tiles.size() ? index : -1; }
+  int focus() const { return focused; }
+
+  // Index of the tile at (x, y) of the mosaic: two tiles on the upper row and the remaining ones on the lower row.
+  int at(int x, int y) const {
+    auto col = x / tile_size.width;
+    auto index = y < tile_size.height ? col : 2 + col;
+    return index >= 0 && static_cast<std::size_t>(index) < tiles.size() ? index : -1;
+  }
+
+  std::vector<cv::Mat> render(bool visible) {
+    std::vector<cv::Mat> images;
+    if (!visible)
+      return images;
+
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+      auto& tile = tiles[i];
+      auto foreground = focused < 0 || static_cast<std::size_t>(focused) == i;
+      auto due = foreground || tile.image.empty() || n_set % policy.background_every == 0;
+      if (tile.dirty && tile.latest != nullptr && due) {
+        auto image = is::msgpack<CompressedImage>(tile.latest);
+        auto reduction = foreground ? policy.focused_reduction : policy.background_reduction;
+        cv::Mat decoded = cv::imdecode(image.data, imread_flag(reduction));
+        if (!decoded.empty()) {
+          cv::resize(decoded, tile.image, tile_size, 0, 0, cv::INTER_AREA);
+          tile.dirty = false;
+        }
+      }
+      if (tile.image.empty()) {
+        tile.image = cv::Mat(tile_size, CV_8UC3, cv::Scalar::all(0));
+      }
+
+      cv::Mat image = tile.image.clone();
+      if (tile.stale)
+        cv::rectangle(image, cv::Rect(0, 0, image.cols, image.rows), cv::Scalar(0, 0, 255), 4);
+      if (static_cast<std::size_t>(focused) == i)
+        cv::rectangle(image, cv::Rect(0, 0, image.cols, image.rows), cv::Scalar(0, 255, 0), 2);
+      images.push_back(image);
+    }
+    return images;
+  }
+
+ private:
+  static int imread_flag(int reduction) {
+    switch (reduction) {
+      case 2:
+        return cv::IMREAD_REDUCED_COLOR_2;
+      case 4:
+        return cv::IMREAD_REDUCED_COLOR_4;
+      case 8:
+        return cv::IMREAD_REDUCED_COLOR_8;
+      default:
+        return cv::IMREAD_COLOR;
+    }
+  }
+
+  std::vector<Tile> tiles;
+  cv::Size tile_size;
+  DecodePolicy policy;
+  int focused{-1};
+  uint64_t n_set{0};
+};
+
+}  // ::camera
+}  // ::is
+
+#endif  // __TILES_HPP__
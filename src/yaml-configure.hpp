@@ -19,51 +19,76 @@ using namespace YAML;
 
 auto mode = [](bool const& mode){ return mode ? "auto" : "manual"; };
 
-void from_configurations(std::map<std::string, Configuration> configurations, std::string const& filename) {
-  Emitter out;
-  out << BeginSeq;
-  for (auto& current : configurations) {
-    auto camera = current.first;
-    auto config = current.second;
-    out << BeginMap;
-    out << Key << "name" << Value << camera;
+// Writes the fields present on 'config' as keys of the current map.
+inline void emit_configuration(Emitter& out, Configuration const& config) {
+  if (config.sampling_rate && (*(config.sampling_rate)).rate) {
     auto sampling_rate = *(config.sampling_rate);
     out << Key << "fps" << Value << *(sampling_rate.rate);
+  }
+  if (config.image_type) {
     auto image_type = *(config.image_type);
     out << Key << "type" << Value << image_type.value;
+  }
+  if (config.resolution) {
     out << Key << "resolution";
       out << BeginMap;
       auto resolution = *(config.resolution);
       out << Key << "width" << Value << resolution.width;
       out << Key << "height" << Value << resolution.height;
       out << EndMap;
+  }
+  if (config.brightness) {
     auto brightness = *(config.brightness);
     out << Key << "brightness" << Value << brightness << Comment(" [1.367~7.422]");
+  }
+  if (config.exposure) {
     out << Key << "exposure";
       out << BeginMap;
       auto exposure = *(config.exposure);
-      out << Key << "mode" << Value << mode(*(exposure.auto_mode));
+      out << Key << "mode" << Value << mode(exposure.auto_mode && *(exposure.auto_mode));
       out << Key << "value" << Value << exposure.value << Comment(" [-7.585~2.414] (0.858)");
       out << EndMap;
+  }
+  if (config.shutter) {
     out << Key << "shutter";
       out << BeginMap;
       auto shutter = *(config.shutter);
-      out << Key << "mode" << Value << mode(*(shutter.auto_mode));
-      out << Key << "percent" << Value << *(shutter.percent);
+      out << Key << "mode" << Value << mode(shutter.auto_mode && *(shutter.auto_mode));
+      if (shutter.percent)
+        out << Key << "percent" << Value << *(shutter.percent);
       out << EndMap;
+  }
+  if (config.gain) {
     out << Key << "gain";
       out << BeginMap;
       auto gain = *(config.gain);
-      out << Key << "mode" << Value << mode(*(gain.auto_mode));
-      out << Key << "percent" << Value << *(gain.percent);
+      out << Key << "mode" << Value << mode(gain.auto_mode && *(gain.auto_mode));
+      if (gain.percent)
+        out << Key << "percent" << Value << *(gain.percent);
       out << EndMap;
+  }
+  if (config.white_balance) {
     out << Key << "white_balance";
       out << BeginMap;
       auto white_balance = *(config.white_balance);
-      out << Key << "mode" << Value << mode(*(white_balance.auto_mode));
-      out << Key << "red" << Value << *(white_balance.red) << Comment(" 0~1023");
-      out << Key << "blue" << Value << *(white_balance.blue) << Comment(" 0~1023");
+      out << Key << "mode" << Value << mode(white_balance.auto_mode && *(white_balance.auto_mode));
+      if (white_balance.red)
+        out << Key << "red" << Value << *(white_balance.red) << Comment(" 0~1023");
+      if (white_balance.blue)
+        out << Key << "blue" << Value << *(white_balance.blue) << Comment(" 0~1023");
       out << EndMap;
+  }
+}
+
+void from_configurations(std::map<std::string, Configuration> configurations, std::string const& filename) {
+  Emitter out;
+  out << BeginSeq;
+  for (auto& current : configurations) {
+    auto camera = current.first;
+    auto config = current.second;
+    out << BeginMap;
+    out << Key << "name" << Value << camera;
+    emit_configuration(out, config);
     out << EndMap;
   }
 